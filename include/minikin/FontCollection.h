@@ -17,6 +17,8 @@
 #ifndef MINIKIN_FONT_COLLECTION_H
 #define MINIKIN_FONT_COLLECTION_H
 
+#include <atomic>
+#include <memory>
 #include <vector>
 
 #include <minikin/MinikinRefCounted.h>
@@ -40,6 +42,10 @@ public:
     void itemize(const uint16_t *string, size_t string_length, FontStyle style,
             std::vector<Run>* result) const;
 
+    // UTF-8 variant of itemize. string_length and the start and end of the runs are in bytes.
+    void itemize(const uint8_t *string, size_t string_length, FontStyle style,
+            std::vector<Run>* result) const;
+
     // Returns true if there is a glyph for the code point and variation selector pair.
     // Returns false if no fonts have a glyph for the code point and variation
     // selector pair, or invalid variation selector is passed.
@@ -62,8 +68,21 @@ private:
         size_t end;
     };
 
+    // Shared implementation of the UTF-16 and UTF-8 itemize.
+    template <typename Decoder>
+    void itemizeImpl(const typename Decoder::Unit* string, size_t string_length, FontStyle style,
+            std::vector<Run>* result) const;
+
     FontFamily* getFamilyForChar(uint32_t ch, uint32_t vs, uint32_t langListId, int variant) const;
 
+    bool isLatin1Covered(uint32_t ch) const {
+        return ch < 0x100 && (mLatin1Coverage[ch >> 5] & (1u << (ch & 31))) != 0;
+    }
+
+    // The scoring part of getFamilyForChar, without the cache.
+    FontFamily* findFamilyForChar(uint32_t ch, uint32_t vs, uint32_t langListId,
+            int variant) const;
+
     uint32_t calcFamilyScore(uint32_t ch, uint32_t vs, int variant, uint32_t langListId,
                              FontFamily* fontFamily) const;
 
@@ -75,7 +94,7 @@ private:
     static uint32_t calcVariantMatchingScore(int variant, const FontFamily& fontFamily);
 
     // static for allocating unique id's
-    static uint32_t sNextId;
+    static std::atomic<uint32_t> sNextId;
 
     // unique id for this font collection (suitable for cache key)
     uint32_t mId;
@@ -96,6 +115,27 @@ private:
 
     // These are offsets into mInstanceVec, one range per page
     std::vector<Range> mRanges;
+
+    // Coverage of the first family for U+0000..U+00FF, one bit per code point. Used by itemize to
+    // extend a run of the first family over Latin-1 text without a per-character lookup.
+    uint32_t mLatin1Coverage[8];
+
+    // Per page union of the families in mRanges and mVSFamilyVec, in collection order, used when
+    // a variation selector is specified. Empty if no family has a cmap 14 subtable.
+    std::vector<FontFamily*> mVSFamilyVecPerPage;
+    std::vector<Range> mVSRanges;
+
+    // Set-associative cache of getFamilyForChar results without variation selector. Each entry
+    // packs the code point, language list id, variant and the index of the chosen family into
+    // mFamilies, so that it can be read and written with a single atomic operation. The answer
+    // for a key never changes since a collection is immutable, so racing writers are harmless.
+    // A miss fills an empty way of the set, or else the way picked by mFamilyCacheVictim.
+    // CJK text uses a few thousand distinct characters, which thrashed the previous 1024 entry
+    // direct-mapped cache; 512 sets of 4 ways (16KB per collection) hold such a working set.
+    static const size_t kFamilyCacheSets = 512;
+    static const size_t kFamilyCacheWays = 4;
+    std::unique_ptr<std::atomic<uint64_t>[]> mFamilyCache;
+    mutable std::atomic<uint32_t> mFamilyCacheVictim;
 };
 
 }  // namespace android
@@ -17,6 +17,8 @@
 #ifndef MINIKIN_FONT_FAMILY_H
 #define MINIKIN_FONT_FAMILY_H
 
+#include <atomic>
+#include <mutex>
 #include <vector>
 #include <string>
 #include <hb.h>
@@ -85,8 +87,8 @@ public:
     FontFakery() : mFakeBold(false), mFakeItalic(false) { }
     FontFakery(bool fakeBold, bool fakeItalic) : mFakeBold(fakeBold), mFakeItalic(fakeItalic) { }
     // TODO: want to support graded fake bolding
-    bool isFakeBold() { return mFakeBold; }
-    bool isFakeItalic() { return mFakeItalic; }
+    bool isFakeBold() const { return mFakeBold; }
+    bool isFakeItalic() const { return mFakeItalic; }
 private:
     bool mFakeBold;
     bool mFakeItalic;
@@ -98,6 +100,9 @@ struct FakedFont {
     FontFakery fakery;
 };
 
+// Fonts must be added to a FontFamily before it is shared with other threads (for example by
+// putting it in a FontCollection). After that the family is only read, and all const methods as
+// well as getCoverage() and hasGlyph() may be called concurrently.
 class FontFamily : public MinikinRefCounted {
 public:
     FontFamily();
@@ -129,18 +134,17 @@ public:
     bool isColorEmojiFamily() const;
 
     // Get Unicode coverage. Lifetime of returned bitset is same as receiver. May return nullptr on
-    // error.
+    // error. The coverage is computed on the first call; concurrent callers wait for it.
     const SparseBitSet* getCoverage();
 
     // Returns true if the font has a glyph for the code point and variation selector pair.
-    // Caller should acquire a lock before calling the method.
     bool hasGlyph(uint32_t codepoint, uint32_t variationSelector);
 
     // Returns true if this font family has a variaion sequence table (cmap format 14 subtable).
     bool hasVSTable() const;
 
 private:
-    void addFontLocked(MinikinFont* typeface, FontStyle style);
+    void addFontInternal(MinikinFont* typeface, FontStyle style);
 
     class Font {
     public:
@@ -153,9 +157,12 @@ private:
     int mVariant;
     std::vector<Font> mFonts;
 
+    // Guards computation of mCoverage and mHasVSTable. Once mCoverageValid is observed to be
+    // true, both can be read without the lock.
+    std::mutex mCoverageLock;
     SparseBitSet mCoverage;
     bool mHasVSTable;
-    bool mCoverageValid;
+    std::atomic<bool> mCoverageValid;
 };
 
 }  // namespace android
@@ -46,11 +46,7 @@ private:
 namespace android {
 
 struct LayoutGlyph {
-    // index into mFaces and mHbFonts vectors. We could imagine
-    // moving this into a run length representation, because it's
-    // more efficient for long strings, and we'll probably need
-    // something like that for paint attributes (color, underline,
-    // fake b/i, etc), as having those per-glyph is bloated.
+    // index into mFaces and mHbFonts vectors
     int font_ix;
 
     unsigned int glyph_id;
@@ -61,6 +57,9 @@ struct LayoutGlyph {
 // Internal state used during layout operation
 struct LayoutContext;
 
+// Shaped word as stored in the layout cache
+class LayoutPiece;
+
 enum {
     kBidi_LTR = 0,
     kBidi_RTL = 1,
@@ -72,15 +71,118 @@ enum {
     kBidi_Mask = 0x7
 };
 
+// Counters for one of the caches used by Layout. hits, misses, evictions and missNanos are
+// cumulative since the last Layout::resetCacheStats(); the other fields describe the current
+// content of the cache.
+struct CacheStats {
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+    uint64_t evictions = 0;
+    size_t entries = 0;
+    // Estimated memory used by the entries. Not tracked for the hb_font_t cache (always 0).
+    size_t bytes = 0;
+    // Sum of the text lengths (in UTF-16 units) of the keys of all entries. The hb_font_t cache
+    // is keyed by font id, so this is always 0 for it.
+    size_t totalKeyLength = 0;
+    // Time spent creating entries on cache misses.
+    uint64_t missNanos = 0;
+
+    float getAverageKeyLength() const {
+        return entries == 0 ? 0.0f : static_cast<float>(totalKeyLength) / entries;
+    }
+};
+
+// One string to measure with Layout::measureTextBatch. The input fields have the same meaning as
+// the arguments of Layout::measureText.
+struct MeasureTextItem {
+    const uint16_t* buf;
+    size_t start;
+    size_t count;
+    size_t bufSize;
+    int bidiFlags;
+    const FontStyle* style;
+    const MinikinPaint* paint;
+    const FontCollection* collection;
+    // Output: per-character advances, count entries. May be null.
+    float* advances;
+    // Output: the total advance of the string.
+    float totalAdvance;
+};
+
+// A range of consecutive glyphs of a Layout that use the same font, as returned by
+// Layout::getFontRun. Glyphs [start, end) are drawn with font and fakery.
+struct LayoutFontRun {
+    MinikinFont* font;
+    FontFakery fakery;
+    size_t start;
+    size_t end;
+};
+
+// Caller-owned arrays that Layout::doLayout can write the glyphs into, instead of keeping them in
+// the Layout object. Any of the glyph arrays may be null if the caller does not need it; the
+// non-null ones must hold glyphCapacity entries. Font indices refer to the faces array.
+struct GlyphOutputBuffers {
+    uint32_t* glyphIds;
+    float* x;
+    float* y;
+    uint32_t* fontIndices;
+    size_t glyphCapacity;
+    FakedFont* faces;
+    size_t faceCapacity;
+    // Output: the number of glyphs and faces produced by the layout. These may exceed the
+    // capacities, in which case only the first glyphCapacity glyphs and faceCapacity faces
+    // were written, and the layout can be redone with larger arrays.
+    size_t glyphCount;
+    size_t faceCount;
+};
+
+// The bidi runs of a paragraph. They are computed once by setParagraph and can then be used by
+// any number of doLayout and measureText calls on ranges of the paragraph, for example once per
+// line after line breaking, instead of running the bidi algorithm on the paragraph every time.
+class BidiParagraph {
+public:
+    BidiParagraph() : mBuf(nullptr), mBufSize(0), mBidiFlags(kBidi_LTR), mRuns() {}
+
+    // Run the bidi algorithm on buf[0, bufSize). The text is not copied, so buf must stay valid
+    // and unchanged while this object is used for layout.
+    void setParagraph(const uint16_t* buf, size_t bufSize, int bidiFlags);
+
+    const uint16_t* getText() const { return mBuf; }
+    size_t getTextSize() const { return mBufSize; }
+    int getBidiFlags() const { return mBidiFlags; }
+
+    // Runs in visual order.
+    size_t nRuns() const { return mRuns.size(); }
+    size_t getRunStart(size_t i) const { return mRuns[i].start; }
+    size_t getRunLength(size_t i) const { return mRuns[i].length; }
+    bool isRunRtl(size_t i) const { return mRuns[i].isRtl; }
+
+private:
+    struct Run {
+        uint32_t start;
+        uint32_t length;
+        bool isRtl;
+    };
+
+    const uint16_t* mBuf;
+    size_t mBufSize;
+    int mBidiFlags;
+    std::vector<Run> mRuns;
+};
+
 // Lifecycle and threading assumptions for Layout:
 // The object is assumed to be owned by a single thread; multiple threads
-// may not mutate it at the same time.
+// may not mutate it at the same time. Different Layout objects may be laid
+// out concurrently, and measureText may be called from any number of threads.
 // The lifetime of the FontCollection set through setFontCollection must
 // extend through the lifetime of the Layout object.
 class Layout {
 public:
 
-    Layout() : mGlyphs(), mAdvances(), mCollection(0), mFaces(), mAdvance(0), mBounds() {
+    Layout() : mGlyphIds(), mGlyphXs(), mGlyphYs(), mFontRuns(), mAdvances(), mCollection(0),
+            mFaces(), mAdvance(0), mBounds(), mBoundsValid(false), mPaint(), mWords(),
+            mRecordWords(false), mWordsValid(false), mWordsForcedLtr(false), mOutput(nullptr),
+            mLastFontRun(0) {
         mBounds.setEmpty();
     }
 
@@ -97,6 +199,62 @@ public:
         int bidiFlags, const FontStyle &style, const MinikinPaint &paint,
         const FontCollection* collection, float* advances);
 
+    // Same as doLayout, but the glyphs are written straight into the caller's arrays. Advances
+    // are still available through getAdvance() and getAdvances(), but the Layout holds no
+    // glyphs afterwards, so nGlyphs() is 0 and getBounds() is empty. Returns false if the
+    // glyphs or faces did not fit; see GlyphOutputBuffers.
+    bool doLayout(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint,
+        GlyphOutputBuffers* output);
+
+    // Same as doLayout and measureText on the text of the paragraph, using its precomputed bidi
+    // runs instead of analyzing the text again.
+    void doLayout(const BidiParagraph& paragraph, size_t start, size_t count,
+        const FontStyle &style, const MinikinPaint &paint);
+
+    static float measureText(const BidiParagraph& paragraph, size_t start, size_t count,
+        const FontStyle &style, const MinikinPaint &paint, const FontCollection* collection,
+        float* advances);
+
+    // Update the layout of a paragraph after an edit, reusing the shaped words that the edit did
+    // not touch. buf is the whole new paragraph, laid out from 0 to bufSize. The oldLength
+    // characters at editStart in the previous text were replaced by the newLength characters now
+    // at buf[editStart]. prev must be the layout of the whole previous paragraph with the same
+    // font collection, style and paint; it may be this object. The result is the same as
+    // doLayout(buf, 0, bufSize, bufSize, ...), except that the x positions of moved glyphs may
+    // differ in the last bit. Only paragraphs that stay a single left to right run are updated
+    // incrementally; others fall back to a full layout.
+    void doLayoutAfterEdit(const Layout& prev, size_t editStart, size_t oldLength,
+        size_t newLength, const uint16_t* buf, size_t bufSize, int bidiFlags,
+        const FontStyle &style, const MinikinPaint &paint);
+
+    // UTF-8 variants of doLayout and measureText. start, count and bufSize are in bytes and
+    // must fall on code point boundaries. Advances are reported per byte: the advance of each
+    // code point is stored at its first byte and the other bytes get 0, so getCharAdvance(i)
+    // takes a byte offset after doLayoutUtf8. Only the words around the range are converted to
+    // UTF-16, unless the text may contain right to left characters and the bidi flags do not
+    // force a direction, in which case the bidi algorithm needs the whole buffer. Layouts made by
+    // doLayoutUtf8 cannot be passed to doLayoutAfterEdit as prev; they fall back to a full layout.
+    void doLayoutUtf8(const uint8_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint);
+
+    static float measureTextUtf8(const uint8_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint,
+        const FontCollection* collection, float* advances);
+
+    // Measure many strings in one call. Equivalent to calling measureText for each item, but
+    // the per-call setup is done once for the whole batch. With parallel layout enabled, large
+    // batches are spread over the worker threads.
+    static void measureTextBatch(MeasureTextItem* items, size_t itemCount);
+
+    // Enable parallel layout with the given number of worker threads, or disable it with 0 (the
+    // default). When enabled, doLayout shapes the words of long paragraphs on the workers and
+    // the calling thread; the result is identical to serial layout.
+    // Every thread that does layout, including the workers, keeps its own scratch state for as
+    // long as it lives; the largest part is a glyph metrics cache of about 100KB. purgeCaches
+    // empties those caches, each thread at its next layout call.
+    static void setLayoutThreadCount(size_t threadCount);
+
     void draw(minikin::Bitmap*, int x0, int y0, float size) const;
 
     // Deprecated. Nont needed. Remove when callers are removed.
@@ -105,33 +263,77 @@ public:
     // public accessors
     size_t nGlyphs() const;
     // Does not bump reference; ownership is still layout
+    // getFont and getFakery find the font run of the glyph. They remember the last run found and
+    // try it and its neighbours first, so loops over the glyphs in either order take constant time
+    // per glyph; random access takes O(log nFontRuns()). Since they update that hint, a Layout
+    // must not be read from several threads at once either. Renderers that draw one run at a
+    // time can use getFontRun instead.
     MinikinFont *getFont(int i) const;
     FontFakery getFakery(int i) const;
     unsigned int getGlyphId(int i) const;
     float getX(int i) const;
     float getY(int i) const;
 
+    // Font runs, in glyph order. Consecutive runs always use different fonts, so renderers can
+    // issue one draw call per run instead of looking up the font of every glyph.
+    size_t nFontRuns() const { return mFontRuns.size(); }
+    LayoutFontRun getFontRun(size_t runIndex) const;
+
     float getAdvance() const;
 
     // Get advances, copying into caller-provided buffer. The size of this
     // buffer must match the length of the string (count arg to doLayout).
-    void getAdvances(float* advances);
+    void getAdvances(float* advances) const;
 
     // The i parameter is an offset within the buf relative to start, it is < count, where
     // start and count are the parameters to doLayout
     float getCharAdvance(size_t i) const { return mAdvances[i]; }
 
+    // Bounds are not computed during layout, since most callers only need advances. The first
+    // call after doLayout computes them from the glyphs.
     void getBounds(MinikinRect* rect);
 
     // Purge all caches, useful in low memory conditions
     static void purgeCaches();
 
+    // Set the memory budget of the layout cache, in bytes. The footprint of each cached word is
+    // estimated from its text and glyph data. Least recently used words are evicted first.
+    static void setLayoutCacheMaxBytes(size_t maxBytes);
+
+    // Set the memory budget of the itemization cache, in bytes, or disable it with 0 (the
+    // default). When enabled, the font runs of every word shaped on a layout cache miss are cached
+    // by collection, style and text, so the font fallback of a word is shared between paints and
+    // hyphenated variants of it.
+    static void setItemizeCacheMaxBytes(size_t maxBytes);
+
+    // Snapshot the statistics of the layout cache and of the hb_font_t cache. Either pointer may
+    // be null. The counters of the individual cache shards are read one at a time, so a snapshot
+    // taken while other threads do layout is only approximately consistent.
+    static void getCacheStats(CacheStats* layoutCacheStats, CacheStats* hbFontCacheStats);
+
+    // Reset the cumulative counters of both caches to zero.
+    static void resetCacheStats();
+
 private:
     friend class LayoutCacheKey;
+    friend class LayoutPiece;
 
     // Find a face in the mFaces vector, or create a new entry
     int findFace(FakedFont face, LayoutContext* ctx);
 
+    // Reorder mFaces by the first glyph that uses each face, as doLayout does, and drop the
+    // faces no glyph uses.
+    void renumberFaces();
+
+    // When paragraph is not null, its bidi runs are used and buf, bufSize and bidiFlags must be
+    // those of the paragraph.
+    void doLayoutWithContext(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, LayoutContext* ctx, const BidiParagraph* paragraph = nullptr);
+
+    static float measureTextWithContext(const uint16_t* buf, size_t start, size_t count,
+        size_t bufSize, int bidiFlags, LayoutContext* ctx, const FontCollection* collection,
+        float* advances, const BidiParagraph* paragraph = nullptr);
+
     // Lay out a single bidi run
     // When layout is not null, layout info will be stored in the object.
     // When advances is not null, measurement results will be stored in the array.
@@ -148,16 +350,81 @@ private:
     void doLayoutRun(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
         bool isRtl, LayoutContext* ctx);
 
-    // Append another layout (for example, cached value) into this one
-    void appendLayout(Layout* src, size_t start);
+    // Append a shaped word (for example, cached value) into this one. Temporary memory is
+    // taken from the scratch arena of ctx.
+    void appendLayout(const LayoutPiece* src, size_t start, LayoutContext* ctx);
+
+    // Write the glyphs of a shaped word into mOutput. fontMap maps the face indices of the
+    // piece to mFaces, and x0 is the pen position of the word.
+    void appendToOutput(const LayoutPiece* src, const int* fontMap, float x0);
+
+    void appendGlyph(int font_ix, unsigned int glyph_id, float x, float y) {
+        appendFontRun(mGlyphIds.size(), font_ix);
+        mGlyphIds.push_back(glyph_id);
+        mGlyphXs.push_back(x);
+        mGlyphYs.push_back(y);
+    }
+
+    // Start a new font run at glyph start, unless the last run already uses faceIx.
+    void appendFontRun(size_t start, uint32_t faceIx) {
+        if (mFontRuns.empty() || mFontRuns.back().faceIx != faceIx) {
+            FontRun run = {static_cast<uint32_t>(start), faceIx};
+            mFontRuns.push_back(run);
+        }
+    }
 
-    std::vector<LayoutGlyph> mGlyphs;
+    // Index of the font run containing glyph i. Updates mLastFontRun.
+    size_t findFontRun(size_t i) const;
+    size_t getFontRunEnd(size_t runIndex) const {
+        return runIndex + 1 < mFontRuns.size() ? mFontRuns[runIndex + 1].start : mGlyphIds.size();
+    }
+
+    // The glyphs are stored as parallel arrays rather than as LayoutGlyph structs, so that
+    // offsetting and copying them can be done with vector instructions.
+    std::vector<uint32_t> mGlyphIds;
+    std::vector<float> mGlyphXs;
+    std::vector<float> mGlyphYs;
+
+    // Glyphs from start up to the start of the next run use mFaces[faceIx].
+    struct FontRun {
+        uint32_t start;
+        uint32_t faceIx;
+    };
+    std::vector<FontRun> mFontRuns;
     std::vector<float> mAdvances;
 
     const FontCollection* mCollection;
     std::vector<FakedFont> mFaces;
     float mAdvance;
+
+    // Lazily computed by getBounds(), using mPaint with the font and fakery of each glyph.
     MinikinRect mBounds;
+    bool mBoundsValid;
+    MinikinPaint mPaint;
+
+    // The cache words appended by appendLayout, in order, for doLayoutAfterEdit. charStart is
+    // the offset of the word in the text and x the pen position before it.
+    struct WordInfo {
+        uint32_t charStart;
+        uint32_t glyphStart;
+        float x;
+        float advance;
+    };
+    std::vector<WordInfo> mWords;
+    // Whether appendLayout adds to mWords. Only set while laying out a layout that
+    // doLayoutAfterEdit may be able to update later.
+    bool mRecordWords;
+    // Set when the layout covers a whole paragraph that is a single left to right run, so that
+    // doLayoutAfterEdit can use mWords.
+    bool mWordsValid;
+    // Set when that run came from kBidi_Force_LTR rather than from the text.
+    bool mWordsForcedLtr;
+
+    // Where appendLayout writes glyphs during doLayout with GlyphOutputBuffers; null otherwise.
+    GlyphOutputBuffers* mOutput;
+
+    // The run findFontRun returned last. Only a hint; it may be out of range after reset().
+    mutable size_t mLastFontRun;
 };
 
 }  // namespace android
@@ -136,6 +136,12 @@ class LineBreaker {
         // set text to current contents of buffer
         void setText();
 
+        // Set UTF-8 text. The text is converted into the buffer, and setText() is called. After
+        // this, addStyleRunUtf8, addReplacementUtf8, getCharWidthsUtf8 and getBreaksUtf8 take
+        // and return byte offsets, which must fall on code point boundaries. The whole text is
+        // converted, since word breaking and hyphenation run over the entire buffer anyway.
+        void setTextUtf8(const uint8_t* text, size_t length);
+
         void setLineWidths(float firstWidth, int firstWidthLineCount, float restWidth);
 
         void setIndents(const std::vector<float>& indents);
@@ -163,12 +169,26 @@ class LineBreaker {
 
         void addReplacement(size_t start, size_t end, float width);
 
+        float addStyleRunUtf8(MinikinPaint* paint, const FontCollection* typeface,
+                FontStyle style, size_t start, size_t end, bool isRtl);
+
+        void addReplacementUtf8(size_t start, size_t end, float width);
+
+        // Copy the widths computed by addStyleRunUtf8 into widths, one entry per byte. The width
+        // of each code point is stored at its first byte.
+        void getCharWidthsUtf8(float* widths) const;
+
         size_t computeBreaks();
 
         const int* getBreaks() const {
             return mBreaks.data();
         }
 
+        // Breaks as byte offsets, after computeBreaks() on text set with setTextUtf8().
+        const int* getBreaksUtf8() const {
+            return mBreaksUtf8.data();
+        }
+
         const float* getWidths() const {
             return mWidths.data();
         }
@@ -218,6 +238,12 @@ class LineBreaker {
         std::vector<uint16_t>mTextBuf;
         std::vector<float>mCharWidths;
 
+        // offset maps for text set with setTextUtf8
+        bool mIsUtf8 = false;
+        std::vector<uint32_t> mUtf16ToUtf8;
+        std::vector<uint32_t> mUtf8ToUtf16;
+        std::vector<int> mBreaksUtf8;
+
         Hyphenator* mHyphenator;
         std::vector<uint8_t> mHyphBuf;
 
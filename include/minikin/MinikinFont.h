@@ -43,13 +43,15 @@ private:
 class MinikinFont;
 
 // Possibly move into own .h file?
-// Note: if you add a field here, either add it to LayoutCacheKey or to skipCache()
+// Note: if you add a field here, also add it to LayoutCacheKey
 struct MinikinPaint {
     MinikinPaint() : font(0), size(0), scaleX(0), skewX(0), letterSpacing(0), paintFlags(0),
             fakery(), fontFeatureSettings() { }
 
-    bool skipCache() const {
-        return !fontFeatureSettings.empty();
+    // Deprecated: paints with font feature settings are cached like any other, so this always
+    // returns false. Kept for callers that still check it.
+    __attribute__((deprecated)) bool skipCache() const {
+        return false;
     }
 
     MinikinFont *font;
@@ -97,6 +99,10 @@ class MinikinFontFreeType;
 // Callback for freeing data
 typedef void (*MinikinDestroyFunc) (void* data);
 
+// Layout and itemization run concurrently on any number of threads without a global lock, so
+// implementations must allow GetHorizontalAdvance, GetBounds and GetTable to be called from several
+// threads at once. Implementations built on a non-thread-safe backend, such as a shared FT_Face,
+// have to serialize access themselves (see MinikinFontFreeType).
 class MinikinFont : public MinikinRefCounted {
 public:
     MinikinFont(int32_t uniqueId) : mUniqueId(uniqueId) {}
@@ -21,6 +21,9 @@
 #include FT_FREETYPE_H
 #include FT_TRUETYPE_TABLES_H
 
+#include <atomic>
+#include <mutex>
+
 #include <minikin/MinikinFont.h>
 
 // An abstraction for platform fonts, allowing Minikin to be used with
@@ -54,7 +57,8 @@ public:
 
     // Not a virtual method, as the protocol to access rendered
     // glyph bitmaps is probably different depending on the
-    // backend.
+    // backend. The bitmap lives in the glyph slot of the face, so it is
+    // only valid until the next call on this font.
     bool Render(uint32_t glyph_id,
         const MinikinPaint &paint, GlyphBitmap *result);
 
@@ -62,7 +66,9 @@ public:
 
 private:
     FT_Face mTypeface;
-    static int32_t sIdCounter;
+    // FreeType faces are not thread-safe; guards every use of mTypeface.
+    mutable std::mutex mFaceMutex;
+    static std::atomic<int32_t> sIdCounter;
 };
 
 }  // namespace android
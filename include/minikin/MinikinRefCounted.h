@@ -19,26 +19,29 @@
 #ifndef MINIKIN_REF_COUNTED_H
 #define MINIKIN_REF_COUNTED_H
 
+#include <atomic>
+
 namespace android {
 
 class MinikinRefCounted {
 public:
-    void RefLocked() { mRefcount_++; }
-    void UnrefLocked() { if (--mRefcount_ == 0) { delete this; } }
-
-    // These refcount operations take the global lock.
+    // The reference count is atomic, so these may be called from any thread.
     void Ref();
     void Unref();
 
+    // Deprecated. There is no global lock anymore; these are the same as Ref() and Unref().
+    // Remove when callers are removed.
+    void RefLocked() { Ref(); }
+    void UnrefLocked() { Unref(); }
+
     MinikinRefCounted() : mRefcount_(1) { }
 
     virtual ~MinikinRefCounted() { };
 private:
-    int mRefcount_;
+    std::atomic<int> mRefcount_;
 };
 
 // An RAII container for reference counted objects.
-// Note: this is only suitable for clients which are _not_ holding the global lock.
 template <typename T>
 class MinikinAutoUnref {
 public:
@@ -34,12 +34,17 @@ minikin_src_files := \
     CmapCoverage.cpp \
     FontCollection.cpp \
     FontFamily.cpp \
+    FontFeatureSettingsCache.cpp \
     FontLanguage.cpp \
     FontLanguageListCache.cpp \
+    GlyphKernels.cpp \
+    GlyphMetricsCache.cpp \
     GraphemeBreak.cpp \
     HbFontCache.cpp \
     Hyphenator.cpp \
+    ItemizeCache.cpp \
     Layout.cpp \
+    LayoutPiece.cpp \
     LayoutUtils.cpp \
     LineBreaker.cpp \
     Measurement.cpp \
@@ -47,7 +52,10 @@ minikin_src_files := \
     MinikinRefCounted.cpp \
     MinikinFont.cpp \
     MinikinFontFreeType.cpp \
+    ScratchArena.cpp \
     SparseBitSet.cpp \
+    ThreadPool.cpp \
+    Utf8Utils.cpp \
     WordBreaker.cpp
 
 minikin_c_includes := \
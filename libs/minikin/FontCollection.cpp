@@ -20,6 +20,13 @@
 
 #include <algorithm>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MINIKIN_USE_NEON
+#endif
+
 #include <log/log.h>
 #include "unicode/unistr.h"
 #include "unicode/unorm2.h"
@@ -27,6 +34,7 @@
 #include "FontLanguage.h"
 #include "FontLanguageListCache.h"
 #include "MinikinInternal.h"
+#include "Utf8Utils.h"
 #include <minikin/FontCollection.h>
 
 using std::vector;
@@ -77,12 +85,15 @@ static bool isEmojiStyleVSBase(uint32_t cp) {
     return std::binary_search(EMOJI_STYLE_VS_BASES, EMOJI_STYLE_VS_BASES + length, cp);
 }
 
-uint32_t FontCollection::sNextId = 0;
+std::atomic<uint32_t> FontCollection::sNextId(0);
 
 FontCollection::FontCollection(const vector<FontFamily*>& typefaces) :
-    mMaxChar(0) {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
-    mId = sNextId++;
+    mMaxChar(0), mFamilyCache(new std::atomic<uint64_t>[kFamilyCacheSets * kFamilyCacheWays]),
+    mFamilyCacheVictim(0) {
+    for (size_t i = 0; i < kFamilyCacheSets * kFamilyCacheWays; i++) {
+        mFamilyCache[i].store(0, std::memory_order_relaxed);
+    }
+    mId = sNextId.fetch_add(1, std::memory_order_relaxed);
     vector<uint32_t> lastChar;
     size_t nTypefaces = typefaces.size();
 #ifdef VERBOSE_DEBUG
@@ -95,10 +106,10 @@ FontCollection::FontCollection(const vector<FontFamily*>& typefaces) :
         if (typeface == NULL) {
             continue;
         }
-        family->RefLocked();
+        family->Ref();
         const SparseBitSet* coverage = family->getCoverage();
         if (coverage == nullptr) {
-            family->UnrefLocked();
+            family->Unref();
             continue;
         }
         mFamilies.push_back(family);  // emplace_back would be better
@@ -111,12 +122,22 @@ FontCollection::FontCollection(const vector<FontFamily*>& typefaces) :
     nTypefaces = mFamilies.size();
     LOG_ALWAYS_FATAL_IF(nTypefaces == 0,
         "Font collection must have at least one valid typeface");
+    const SparseBitSet* firstCoverage = mFamilies[0]->getCoverage();
+    for (uint32_t c = 0; c < 0x100; c++) {
+        if (c % 32 == 0) {
+            mLatin1Coverage[c / 32] = 0;
+        }
+        if (firstCoverage->get(c)) {
+            mLatin1Coverage[c / 32] |= 1u << (c % 32);
+        }
+    }
     size_t nPages = (mMaxChar + kPageMask) >> kLogCharsPerPage;
     size_t offset = 0;
     // TODO: Use variation selector map for mRanges construction.
     // A font can have a glyph for a base code point and variation selector pair but no glyph for
     // the base code point without variation selector. The family won't be listed in the range in
     // this case.
+    const bool hasVSFamily = !mVSFamilyVec.empty();
     for (size_t i = 0; i < nPages; i++) {
         Range dummy;
         mRanges.push_back(dummy);
@@ -125,9 +146,10 @@ FontCollection::FontCollection(const vector<FontFamily*>& typefaces) :
         ALOGD("i=%zd: range start = %zd\n", i, offset);
 #endif
         range->start = offset;
+        const size_t vsStart = mVSFamilyVecPerPage.size();
         for (size_t j = 0; j < nTypefaces; j++) {
+            FontFamily* family = mFamilies[j];
             if (lastChar[j] < (i + 1) << kLogCharsPerPage) {
-                FontFamily* family = mFamilies[j];
                 mFamilyVec.push_back(family);
                 offset++;
                 uint32_t nextChar = family->getCoverage()->nextSetBit((i + 1) << kLogCharsPerPage);
@@ -135,15 +157,23 @@ FontCollection::FontCollection(const vector<FontFamily*>& typefaces) :
                 ALOGD("nextChar = %d (j = %zd)\n", nextChar, j);
 #endif
                 lastChar[j] = nextChar;
+                if (hasVSFamily) {
+                    mVSFamilyVecPerPage.push_back(family);
+                }
+            } else if (hasVSFamily && family->hasVSTable()) {
+                mVSFamilyVecPerPage.push_back(family);
             }
         }
         range->end = offset;
+        if (hasVSFamily) {
+            mVSRanges.push_back({ vsStart, mVSFamilyVecPerPage.size() });
+        }
     }
 }
 
 FontCollection::~FontCollection() {
     for (size_t i = 0; i < mFamilies.size(); i++) {
-        mFamilies[i]->UnrefLocked();
+        mFamilies[i]->Unref();
     }
 }
 
@@ -251,16 +281,46 @@ uint32_t FontCollection::calcCoverageScore(uint32_t ch, uint32_t vs, FontFamily*
 //   LanguageScore = s(0) * 3^(m - 1) + s(1) * 3^(m - 2) + ... + s(m - 2) * 3 + s(m - 1)
 // Here, m is the maximum number of languages to be compared, and s(i) is the i-th language's
 // matching score. The possible values of s(i) are 0, 1 and 2.
+//
+// The score only depends on the two language list ids, which are never reused, so scores are
+// memoized in a process-wide direct-mapped table. Each entry packs both ids and the score into one
+// 64-bit atomic: the score is below 3^17 < 2^28 and the ids of the first 65536 language lists fit
+// in 16 bits. Pairs involving later lists are not memoized.
+static const int kScoreCacheIdBits = 16;
+static const int kScoreCacheScoreBits = 28;
+static const uint64_t kScoreCacheValid = 1ull << 63;
+static const size_t kScoreCacheSize = 4096;
+static std::atomic<uint64_t> sScoreCache[kScoreCacheSize];
+
 uint32_t FontCollection::calcLanguageMatchingScore(
         uint32_t userLangListId, const FontFamily& fontFamily) {
+    const uint32_t fontLangListId = fontFamily.langId();
+    const bool cacheable = userLangListId < (1u << kScoreCacheIdBits)
+            && fontLangListId < (1u << kScoreCacheIdBits);
+    const uint64_t key = static_cast<uint64_t>(userLangListId) << kScoreCacheIdBits
+            | fontLangListId;
+    const size_t slot = ((key * 0x9E3779B97F4A7C15ull) >> 40) & (kScoreCacheSize - 1);
+    if (cacheable) {
+        const uint64_t entry = sScoreCache[slot].load(std::memory_order_relaxed);
+        if ((entry & kScoreCacheValid)
+                && (entry & ((1ull << (2 * kScoreCacheIdBits)) - 1)) == key) {
+            return (entry >> (2 * kScoreCacheIdBits)) & ((1u << kScoreCacheScoreBits) - 1);
+        }
+    }
+
     const FontLanguages& langList = FontLanguageListCache::getById(userLangListId);
-    const FontLanguages& fontLanguages = FontLanguageListCache::getById(fontFamily.langId());
+    const FontLanguages& fontLanguages = FontLanguageListCache::getById(fontLangListId);
 
     const size_t maxCompareNum = std::min(langList.size(), FONT_LANGUAGES_LIMIT);
     uint32_t score = 0;
     for (size_t i = 0; i < maxCompareNum; ++i) {
         score = score * 3u + langList[i].calcScoreFor(fontLanguages);
     }
+    if (cacheable) {
+        sScoreCache[slot].store(kScoreCacheValid
+                | static_cast<uint64_t>(score) << (2 * kScoreCacheIdBits) | key,
+                std::memory_order_relaxed);
+    }
     return score;
 }
 
@@ -271,12 +331,70 @@ uint32_t FontCollection::calcVariantMatchingScore(int variant, const FontFamily&
     return (fontFamily.variant() == 0 || fontFamily.variant() == variant) ? 1 : 0;
 }
 
+// Layout of the entries of mFamilyCache. An entry of 0 is empty, since the valid bit is clear.
+static const int kFamilyCacheChBits = 21;
+static const int kFamilyCacheVariantBits = 2;
+static const int kFamilyCacheLangBits = 24;
+static const int kFamilyCacheIndexBits = 16;
+static const int kFamilyCacheKeyBits =
+        kFamilyCacheChBits + kFamilyCacheVariantBits + kFamilyCacheLangBits;
+static const uint64_t kFamilyCacheKeyMask = (1ull << kFamilyCacheKeyBits) - 1;
+static const uint64_t kFamilyCacheValid = 1ull << 63;
+
+static bool packFamilyCacheKey(uint32_t ch, uint32_t langListId, int variant, uint64_t* key) {
+    if (langListId >= (1u << kFamilyCacheLangBits) || variant < 0
+            || variant >= (1 << kFamilyCacheVariantBits)) {
+        return false;
+    }
+    *key = static_cast<uint64_t>(ch)
+            | static_cast<uint64_t>(variant) << kFamilyCacheChBits
+            | static_cast<uint64_t>(langListId) << (kFamilyCacheChBits + kFamilyCacheVariantBits);
+    return true;
+}
+
+FontFamily* FontCollection::getFamilyForChar(uint32_t ch, uint32_t vs,
+            uint32_t langListId, int variant) const {
+    if (ch >= mMaxChar) {
+        return mFamilies[0];
+    }
+    uint64_t key;
+    if (vs != 0 || mFamilies.size() >= (1u << kFamilyCacheIndexBits)
+            || !packFamilyCacheKey(ch, langListId, variant, &key)) {
+        return findFamilyForChar(ch, vs, langListId, variant);
+    }
+
+    const size_t set = ((key * 0x9E3779B97F4A7C15ull) >> 32) & (kFamilyCacheSets - 1);
+    std::atomic<uint64_t>* ways = &mFamilyCache[set * kFamilyCacheWays];
+    size_t victim = kFamilyCacheWays;
+    for (size_t i = 0; i < kFamilyCacheWays; i++) {
+        const uint64_t entry = ways[i].load(std::memory_order_relaxed);
+        if (!(entry & kFamilyCacheValid)) {
+            if (victim == kFamilyCacheWays) {
+                victim = i;
+            }
+        } else if ((entry & kFamilyCacheKeyMask) == key) {
+            return mFamilies[(entry >> kFamilyCacheKeyBits) & ((1u << kFamilyCacheIndexBits) - 1)];
+        }
+    }
+    if (victim == kFamilyCacheWays) {
+        // Round robin replacement; on CJK text it misses about half as often as picking the way
+        // from the hash of the key.
+        victim = mFamilyCacheVictim.fetch_add(1, std::memory_order_relaxed) % kFamilyCacheWays;
+    }
+
+    FontFamily* family = findFamilyForChar(ch, vs, langListId, variant);
+    const size_t index = std::find(mFamilies.begin(), mFamilies.end(), family) - mFamilies.begin();
+    ways[victim].store(kFamilyCacheValid | static_cast<uint64_t>(index) << kFamilyCacheKeyBits
+            | key, std::memory_order_relaxed);
+    return family;
+}
+
 // Implement heuristic for choosing best-match font. Here are the rules:
 // 1. If first font in the collection has the character, it wins.
 // 2. Calculate a score for the font family. See comments in calcFamilyScore for the detail.
 // 3. Highest score wins, with ties resolved to the first font.
 // This method never returns nullptr.
-FontFamily* FontCollection::getFamilyForChar(uint32_t ch, uint32_t vs,
+FontFamily* FontCollection::findFamilyForChar(uint32_t ch, uint32_t vs,
             uint32_t langListId, int variant) const {
     if (ch >= mMaxChar) {
         return mFamilies[0];
@@ -285,19 +403,11 @@ FontFamily* FontCollection::getFamilyForChar(uint32_t ch, uint32_t vs,
     const std::vector<FontFamily*>* familyVec = &mFamilyVec;
     Range range = mRanges[ch >> kLogCharsPerPage];
 
-    std::vector<FontFamily*> familyVecForVS;
-    if (vs != 0) {
+    if (vs != 0 && !mVSRanges.empty()) {
         // If variation selector is specified, need to search for both the variation sequence and
-        // its base codepoint. Compute the union vector of them.
-        familyVecForVS = mVSFamilyVec;
-        familyVecForVS.insert(familyVecForVS.end(),
-                mFamilyVec.begin() + range.start, mFamilyVec.begin() + range.end);
-        std::sort(familyVecForVS.begin(), familyVecForVS.end());
-        auto last = std::unique(familyVecForVS.begin(), familyVecForVS.end());
-        familyVecForVS.erase(last, familyVecForVS.end());
-
-        familyVec = &familyVecForVS;
-        range = { 0, familyVecForVS.size() };
+        // its base codepoint. The union of them is precomputed per page.
+        familyVec = &mVSFamilyVecPerPage;
+        range = mVSRanges[ch >> kLogCharsPerPage];
     }
 
 #ifdef VERBOSE_DEBUG
@@ -369,8 +479,6 @@ bool FontCollection::hasVariationSelector(uint32_t baseCodepoint,
         return false;
     }
 
-    std::lock_guard<std::mutex> _l(gMinikinLock);
-
     // Currently mRanges can not be used here since it isn't aware of the variation sequence.
     for (size_t i = 0; i < mVSFamilyVec.size(); i++) {
         if (mVSFamilyVec[i]->hasGlyph(baseCodepoint, variationSelector)) {
@@ -392,8 +500,100 @@ bool FontCollection::hasVariationSelector(uint32_t baseCodepoint,
     return false;
 }
 
+// Returns the length of the longest prefix of string whose code units are all below 0x100.
+static size_t latin1PrefixLength(const uint16_t* string, size_t size) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128i highMask = _mm_set1_epi16(static_cast<short>(0xFF00));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 8 <= size; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(string + i));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(v, highMask), zero)) != 0xFFFF) {
+            break;
+        }
+    }
+#elif defined(MINIKIN_USE_NEON)
+    const uint16x8_t highMask = vdupq_n_u16(0xFF00);
+    for (; i + 8 <= size; i += 8) {
+        const uint64x2_t high = vreinterpretq_u64_u16(vandq_u16(vld1q_u16(string + i), highMask));
+        if ((vgetq_lane_u64(high, 0) | vgetq_lane_u64(high, 1)) != 0) {
+            break;
+        }
+    }
+#endif
+    while (i < size && string[i] < 0x100) {
+        i++;
+    }
+    return i;
+}
+
+// Returns the length of the longest prefix of string whose bytes are all ASCII.
+static size_t asciiPrefixLength(const uint8_t* string, size_t size) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= size; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(string + i));
+        if (_mm_movemask_epi8(v) != 0) {
+            break;
+        }
+    }
+#elif defined(MINIKIN_USE_NEON)
+    const uint8x16_t highMask = vdupq_n_u8(0x80);
+    for (; i + 16 <= size; i += 16) {
+        const uint64x2_t high = vreinterpretq_u64_u8(vandq_u8(vld1q_u8(string + i), highMask));
+        if ((vgetq_lane_u64(high, 0) | vgetq_lane_u64(high, 1)) != 0) {
+            break;
+        }
+    }
+#endif
+    while (i < size && string[i] < 0x80) {
+        i++;
+    }
+    return i;
+}
+
+namespace {
+
+// next() decodes the code point at *offset and advances it. singleUnitPrefixLength() returns the
+// length of the longest prefix made of code points below U+0100 that take a single code unit.
+struct Utf16Decoder {
+    typedef uint16_t Unit;
+    static uint32_t next(const uint16_t* string, size_t* offset, size_t size) {
+        uint32_t ch;
+        U16_NEXT(string, *offset, size, ch);
+        return ch;
+    }
+    static size_t singleUnitPrefixLength(const uint16_t* string, size_t size) {
+        return latin1PrefixLength(string, size);
+    }
+};
+
+struct Utf8Decoder {
+    typedef uint8_t Unit;
+    static uint32_t next(const uint8_t* string, size_t* offset, size_t size) {
+        return nextUtf8CodePoint(string, offset, size);
+    }
+    static size_t singleUnitPrefixLength(const uint8_t* string, size_t size) {
+        return asciiPrefixLength(string, size);
+    }
+};
+
+}  // namespace
+
 void FontCollection::itemize(const uint16_t *string, size_t string_size, FontStyle style,
         vector<Run>* result) const {
+    itemizeImpl<Utf16Decoder>(string, string_size, style, result);
+}
+
+void FontCollection::itemize(const uint8_t *string, size_t string_size, FontStyle style,
+        vector<Run>* result) const {
+    itemizeImpl<Utf8Decoder>(string, string_size, style, result);
+}
+
+// Offsets below are in code units of the Decoder's encoding.
+template <typename Decoder>
+void FontCollection::itemizeImpl(const typename Decoder::Unit* string, size_t string_size,
+        FontStyle style, vector<Run>* result) const {
     const uint32_t langListId = style.getLanguageListId();
     int variant = style.getVariant();
     FontFamily* lastFamily = NULL;
@@ -407,16 +607,40 @@ void FontCollection::itemize(const uint16_t *string, size_t string_size, FontSty
 
     uint32_t nextCh = 0;
     uint32_t prevCh = 0;
+    size_t prevChLength = 0;
     size_t nextUtf16Pos = 0;
     size_t readLength = 0;
-    U16_NEXT(string, readLength, string_size, nextCh);
+    nextCh = Decoder::next(string, &readLength, string_size);
 
     do {
+        if (lastFamily == mFamilies[0] && isLatin1Covered(nextCh)) {
+            // Fast path: every character of a span of Latin-1 text covered by the first family
+            // resolves to the first family, so the current run can be extended over the span
+            // directly. The last character is left to the loop below since it may be followed by
+            // a variation selector or a combining mark.
+            const size_t spanStart = nextUtf16Pos;
+            const size_t latin1End = spanStart + Decoder::singleUnitPrefixLength(
+                    string + spanStart, string_size - spanStart);
+            size_t spanEnd = spanStart;
+            while (spanEnd < latin1End && isLatin1Covered(string[spanEnd])) {
+                spanEnd++;
+            }
+            if (spanEnd - spanStart >= 2) {
+                const size_t last = spanEnd - 1;
+                prevCh = string[last - 1];
+                prevChLength = 1;
+                run->end = last;
+                nextUtf16Pos = last;
+                readLength = last;
+                nextCh = Decoder::next(string, &readLength, string_size);
+            }
+        }
+
         const uint32_t ch = nextCh;
         const size_t utf16Pos = nextUtf16Pos;
         nextUtf16Pos = readLength;
         if (readLength < string_size) {
-            U16_NEXT(string, readLength, string_size, nextCh);
+            nextCh = Decoder::next(string, &readLength, string_size);
         } else {
             nextCh = kEndOfString;
         }
@@ -446,7 +670,6 @@ void FontCollection::itemize(const uint16_t *string, size_t string_size, FontSty
                         ((U_GET_GC_MASK(ch) & U_GC_M_MASK) != 0 ||
                          (isEmojiModifier(ch) && isEmojiBase(prevCh))) &&
                         family && family->getCoverage()->get(prevCh)) {
-                    const size_t prevChLength = U16_LENGTH(prevCh);
                     run->end -= prevChLength;
                     if (run->start == run->end) {
                         result->pop_back();
@@ -462,6 +685,7 @@ void FontCollection::itemize(const uint16_t *string, size_t string_size, FontSty
             }
         }
         prevCh = ch;
+        prevChLength = nextUtf16Pos - utf16Pos;
         run->end = nextUtf16Pos;  // exclusive
     } while (nextCh != kEndOfString);
 }
@@ -55,7 +55,6 @@ hash_t FontStyle::hash() const {
 
 // static
 uint32_t FontStyle::registerLanguageList(const std::string& languages) {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
     return FontLanguageListCache::getId(languages);
 }
 
@@ -72,12 +71,11 @@ FontFamily::FontFamily(int variant) : FontFamily(FontLanguageListCache::kEmptyLi
 
 FontFamily::~FontFamily() {
     for (size_t i = 0; i < mFonts.size(); i++) {
-        mFonts[i].typeface->UnrefLocked();
+        mFonts[i].typeface->Unref();
     }
 }
 
 bool FontFamily::addFont(MinikinFont* typeface) {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
     const uint32_t os2Tag = MinikinFont::MakeTag('O', 'S', '/', '2');
     HbBlob os2Table(getFontTable(typeface, os2Tag));
     if (os2Table.get() == nullptr) return false;
@@ -86,7 +84,7 @@ bool FontFamily::addFont(MinikinFont* typeface) {
     if (analyzeStyle(os2Table.get(), os2Table.size(), &weight, &italic)) {
         //ALOGD("analyzed weight = %d, italic = %s", weight, italic ? "true" : "false");
         FontStyle style(weight, italic);
-        addFontLocked(typeface, style);
+        addFontInternal(typeface, style);
         return true;
     } else {
         ALOGD("failed to analyze style");
@@ -95,14 +93,13 @@ bool FontFamily::addFont(MinikinFont* typeface) {
 }
 
 void FontFamily::addFont(MinikinFont* typeface, FontStyle style) {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
-    addFontLocked(typeface, style);
+    addFontInternal(typeface, style);
 }
 
-void FontFamily::addFontLocked(MinikinFont* typeface, FontStyle style) {
-    typeface->RefLocked();
+void FontFamily::addFontInternal(MinikinFont* typeface, FontStyle style) {
+    typeface->Ref();
     mFonts.push_back(Font(typeface, style));
-    mCoverageValid = false;
+    mCoverageValid.store(false, std::memory_order_relaxed);
 }
 
 // Compute a matching metric between two styles - 0 is an exact match
@@ -169,7 +166,11 @@ bool FontFamily::isColorEmojiFamily() const {
 }
 
 const SparseBitSet* FontFamily::getCoverage() {
-    if (!mCoverageValid) {
+    if (mCoverageValid.load(std::memory_order_acquire)) {
+        return &mCoverage;
+    }
+    std::lock_guard<std::mutex> _l(mCoverageLock);
+    if (!mCoverageValid.load(std::memory_order_relaxed)) {
         const FontStyle defaultStyle;
         MinikinFont* typeface = getClosestMatch(defaultStyle).font;
         const uint32_t cmapTag = MinikinFont::MakeTag('c', 'm', 'a', 'p');
@@ -186,13 +187,12 @@ const SparseBitSet* FontFamily::getCoverage() {
         ALOGD("font coverage length=%d, first ch=%x\n", mCoverage.length(),
                 mCoverage.nextSetBit(0));
 #endif
-        mCoverageValid = true;
+        mCoverageValid.store(true, std::memory_order_release);
     }
     return &mCoverage;
 }
 
 bool FontFamily::hasGlyph(uint32_t codepoint, uint32_t variationSelector) {
-    assertMinikinLocked();
     if (variationSelector != 0 && !mHasVSTable) {
         // Early exit if the variation selector is specified but the font doesn't have a cmap format
         // 14 subtable.
@@ -201,7 +201,7 @@ bool FontFamily::hasGlyph(uint32_t codepoint, uint32_t variationSelector) {
 
     const FontStyle defaultStyle;
     MinikinFont* minikinFont = getClosestMatch(defaultStyle).font;
-    hb_font_t* font = getHbFontLocked(minikinFont);
+    hb_font_t* font = getHbFont(minikinFont);
     uint32_t unusedGlyph;
     bool result = hb_font_get_glyph(font, codepoint, variationSelector, &unusedGlyph);
     hb_font_destroy(font);
@@ -209,7 +209,8 @@ bool FontFamily::hasGlyph(uint32_t codepoint, uint32_t variationSelector) {
 }
 
 bool FontFamily::hasVSTable() const {
-    LOG_ALWAYS_FATAL_IF(!mCoverageValid, "Do not call this method before getCoverage() call");
+    LOG_ALWAYS_FATAL_IF(!mCoverageValid.load(std::memory_order_acquire),
+            "Do not call this method before getCoverage() call");
     return mHasVSTable;
 }
 
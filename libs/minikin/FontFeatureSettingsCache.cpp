@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "FontFeatureSettingsCache.h"
+
+#include <string.h>
+
+#include <log/log.h>
+
+namespace android {
+
+const uint32_t FontFeatureSettingsCache::kEmptySettingsId;
+const uint32_t FontFeatureSettingsCache::kUncachedSettingsId;
+const uint32_t FontFeatureSettingsCache::kMaxSettings;
+
+// static
+void FontFeatureSettingsCache::parse(const std::string& str, FontFeatureSettings* features) {
+    const char* start = str.c_str();
+    const char* end = start + str.size();
+
+    while (start < end) {
+        hb_feature_t feature;
+        const char* p = strchr(start, ',');
+        if (!p)
+            p = end;
+        /* We do not allow setting features on ranges.  As such, reject any
+         * setting that has non-universal range. */
+        if (hb_feature_from_string (start, p - start, &feature)
+                && feature.start == 0 && feature.end == (unsigned int) -1)
+            features->push_back(feature);
+        start = p + 1;
+    }
+}
+
+// static
+uint32_t FontFeatureSettingsCache::getId(const std::string& settings) {
+    if (settings.empty()) {
+        return kEmptySettingsId;
+    }
+    FontFeatureSettingsCache* inst = FontFeatureSettingsCache::getInstance();
+    const uint32_t id = inst->mSettings.find(settings);
+    if (id != InternTable<FontFeatureSettings>::kNotInterned) {
+        return id;
+    }
+
+    // Given settings are not in cache. Insert them and return newly assigned ID. Settings without
+    // any valid feature are not interned, so that garbage strings do not fill the table.
+    FontFeatureSettings features;
+    parse(settings, &features);
+    if (features.empty()) {
+        return kEmptySettingsId;
+    }
+    const uint32_t newId = inst->mSettings.insert(settings, std::move(features));
+    return newId == InternTable<FontFeatureSettings>::kNotInterned ? kUncachedSettingsId : newId;
+}
+
+// static
+const FontFeatureSettings& FontFeatureSettingsCache::getById(uint32_t id) {
+    return FontFeatureSettingsCache::getInstance()->mSettings.getById(id);
+}
+
+// static
+FontFeatureSettingsCache* FontFeatureSettingsCache::getInstance() {
+    static FontFeatureSettingsCache* instance = [] {
+        FontFeatureSettingsCache* cache = new FontFeatureSettingsCache();
+
+        // Insert an empty list for mapping the empty settings string to kEmptySettingsId.
+        cache->mSettings.insert("", FontFeatureSettings());
+        return cache;
+    }();
+    return instance;
+}
+
+}  // namespace android
@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_FONT_FEATURE_SETTINGS_CACHE_H
+#define MINIKIN_FONT_FEATURE_SETTINGS_CACHE_H
+
+#include <string>
+#include <vector>
+
+#include <hb.h>
+
+#include "InternTable.h"
+
+namespace android {
+
+typedef std::vector<hb_feature_t> FontFeatureSettings;
+
+// Interns MinikinPaint::fontFeatureSettings strings into compact IDs, so that the layout cache can
+// key on the features without storing the string.
+class FontFeatureSettingsCache {
+public:
+    // A special ID for the empty feature list. Strings without any valid feature map to it.
+    const static uint32_t kEmptySettingsId = 0;
+
+    // Returned by getId once kMaxSettings distinct settings have been interned. Layout with such
+    // settings parses them on every call and bypasses the layout cache.
+    const static uint32_t kUncachedSettingsId = UINT32_MAX;
+
+    // Returns the ID for the given comma separated feature settings, e.g. "tnum,smcp".
+    // Thread-safe; only takes one of the cache's sharded locks, and none for the empty string.
+    static uint32_t getId(const std::string& settings);
+
+    // Returns the parsed features for the ID, which must not be kUncachedSettingsId. Thread-safe
+    // and lock-free. The returned reference stays valid for the process lifetime.
+    static const FontFeatureSettings& getById(uint32_t id);
+
+    // Appends the valid features of the settings string to features.
+    static void parse(const std::string& settings, FontFeatureSettings* features);
+
+private:
+    // Bounds the memory held by apps that build feature strings dynamically.
+    static const uint32_t kMaxSettings = 4096;
+
+    FontFeatureSettingsCache() : mSettings(kMaxSettings) {}  // Singleton
+    ~FontFeatureSettingsCache() {}
+
+    static FontFeatureSettingsCache* getInstance();
+
+    InternTable<FontFeatureSettings> mSettings;
+};
+
+}  // namespace android
+
+#endif  // MINIKIN_FONT_FEATURE_SETTINGS_CACHE_H
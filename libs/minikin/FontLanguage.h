@@ -101,6 +101,7 @@ public:
     FontLanguages(std::vector<FontLanguage>&& languages);
     FontLanguages() : mUnionOfSubScriptBits(0), mIsAllTheSameLanguage(false) {}
     FontLanguages(FontLanguages&&) = default;
+    FontLanguages& operator=(FontLanguages&&) = default;
 
     size_t size() const { return mLanguages.size(); }
     bool empty() const { return mLanguages.empty(); }
@@ -24,7 +24,6 @@
 #include <log/log.h>
 
 #include "FontLanguage.h"
-#include "MinikinInternal.h"
 
 namespace android {
 
@@ -114,42 +113,40 @@ static std::vector<FontLanguage> parseLanguageList(const std::string& input) {
 // static
 uint32_t FontLanguageListCache::getId(const std::string& languages) {
     FontLanguageListCache* inst = FontLanguageListCache::getInstance();
-    std::unordered_map<std::string, uint32_t>::const_iterator it =
-            inst->mLanguageListLookupTable.find(languages);
-    if (it != inst->mLanguageListLookupTable.end()) {
-        return it->second;
+    const uint32_t id = inst->mLanguageLists.find(languages);
+    if (id != InternTable<FontLanguages>::kNotInterned) {
+        return id;
     }
 
     // Given language list is not in cache. Insert it and return newly assigned ID.
-    const uint32_t nextId = inst->mLanguageLists.size();
     FontLanguages fontLanguages(parseLanguageList(languages));
     if (fontLanguages.empty()) {
         return kEmptyListId;
     }
-    inst->mLanguageLists.push_back(std::move(fontLanguages));
-    inst->mLanguageListLookupTable.insert(std::make_pair(languages, nextId));
+    const uint32_t nextId = inst->mLanguageLists.insert(languages, std::move(fontLanguages));
+    if (nextId == InternTable<FontLanguages>::kNotInterned) {
+        // Only reachable after 2^32 distinct language lists.
+        ALOGE("Too many language lists, ignoring \"%s\".", languages.c_str());
+        return kEmptyListId;
+    }
     return nextId;
 }
 
 // static
 const FontLanguages& FontLanguageListCache::getById(uint32_t id) {
-    FontLanguageListCache* inst = FontLanguageListCache::getInstance();
-    LOG_ALWAYS_FATAL_IF(id >= inst->mLanguageLists.size(), "Lookup by unknown language list ID.");
-    return inst->mLanguageLists[id];
+    return FontLanguageListCache::getInstance()->mLanguageLists.getById(id);
 }
 
 // static
 FontLanguageListCache* FontLanguageListCache::getInstance() {
-    assertMinikinLocked();
-    static FontLanguageListCache* instance = nullptr;
-    if (instance == nullptr) {
-        instance = new FontLanguageListCache();
+    static FontLanguageListCache* instance = [] {
+        FontLanguageListCache* cache = new FontLanguageListCache();
 
         // Insert an empty language list for mapping default language list to kEmptyListId.
         // The default language list has only one FontLanguage and it is the unsupported language.
-        instance->mLanguageLists.push_back(FontLanguages());
-        instance->mLanguageListLookupTable.insert(std::make_pair("", kEmptyListId));
-    }
+        cache->mLanguageLists.insert("", FontLanguages());
+        return cache;
+    }();
     return instance;
 }
 
@@ -17,10 +17,9 @@
 #ifndef MINIKIN_FONT_LANGUAGE_LIST_CACHE_H
 #define MINIKIN_FONT_LANGUAGE_LIST_CACHE_H
 
-#include <unordered_map>
-
 #include <minikin/FontFamily.h>
 #include "FontLanguage.h"
+#include "InternTable.h"
 
 namespace android {
 
@@ -32,23 +31,20 @@ public:
     const static uint32_t kEmptyListId = 0;
 
     // Returns language list ID for the given string representation of FontLanguages.
-    // Caller should acquire a lock before calling the method.
+    // Thread-safe; only takes one of the cache's sharded locks.
     static uint32_t getId(const std::string& languages);
 
-    // Caller should acquire a lock before calling the method.
+    // Thread-safe and lock-free. The returned reference stays valid for the process lifetime.
     static const FontLanguages& getById(uint32_t id);
 
 private:
-    FontLanguageListCache() {}  // Singleton
+    FontLanguageListCache() : mLanguageLists(UINT32_MAX) {}  // Singleton
     ~FontLanguageListCache() {}
 
-    // Caller should acquire a lock before calling the method.
     static FontLanguageListCache* getInstance();
 
-    std::vector<FontLanguages> mLanguageLists;
-
-    // A map from string representation of the font language list to the ID.
-    std::unordered_map<std::string, uint32_t> mLanguageListLookupTable;
+    // Language lists by ID, and the IDs of their string representations.
+    InternTable<FontLanguages> mLanguageLists;
 };
 
 }  // namespace android
@@ -0,0 +1,117 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GlyphKernels.h"
+
+#include <algorithm>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MINIKIN_USE_NEON
+#endif
+
+namespace android {
+
+void offsetPositions(float* dst, const float* src, float offset, size_t n) {
+    size_t i = 0;
+#if defined(__SSE2__)
+    const __m128 v = _mm_set1_ps(offset);
+    for (; i + 4 <= n; i += 4) {
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(src + i), v));
+    }
+#elif defined(MINIKIN_USE_NEON)
+    const float32x4_t v = vdupq_n_f32(offset);
+    for (; i + 4 <= n; i += 4) {
+        vst1q_f32(dst + i, vaddq_f32(vld1q_f32(src + i), v));
+    }
+#endif
+    for (; i < n; i++) {
+        dst[i] = src[i] + offset;
+    }
+}
+
+void joinRects(const float* lefts, const float* tops, const float* rights, const float* bottoms,
+        size_t n, MinikinRect* rect) {
+    if (n == 0) {
+        return;
+    }
+    float left = lefts[0];
+    float top = tops[0];
+    float right = rights[0];
+    float bottom = bottoms[0];
+    size_t i = 1;
+#if defined(__SSE2__)
+    if (n >= 4) {
+        __m128 l = _mm_loadu_ps(lefts);
+        __m128 t = _mm_loadu_ps(tops);
+        __m128 r = _mm_loadu_ps(rights);
+        __m128 b = _mm_loadu_ps(bottoms);
+        for (i = 4; i + 4 <= n; i += 4) {
+            l = _mm_min_ps(l, _mm_loadu_ps(lefts + i));
+            t = _mm_min_ps(t, _mm_loadu_ps(tops + i));
+            r = _mm_max_ps(r, _mm_loadu_ps(rights + i));
+            b = _mm_max_ps(b, _mm_loadu_ps(bottoms + i));
+        }
+        float ls[4], ts[4], rs[4], bs[4];
+        _mm_storeu_ps(ls, l);
+        _mm_storeu_ps(ts, t);
+        _mm_storeu_ps(rs, r);
+        _mm_storeu_ps(bs, b);
+        left = *std::min_element(ls, ls + 4);
+        top = *std::min_element(ts, ts + 4);
+        right = *std::max_element(rs, rs + 4);
+        bottom = *std::max_element(bs, bs + 4);
+    }
+#elif defined(MINIKIN_USE_NEON)
+    if (n >= 4) {
+        float32x4_t l = vld1q_f32(lefts);
+        float32x4_t t = vld1q_f32(tops);
+        float32x4_t r = vld1q_f32(rights);
+        float32x4_t b = vld1q_f32(bottoms);
+        for (i = 4; i + 4 <= n; i += 4) {
+            l = vminq_f32(l, vld1q_f32(lefts + i));
+            t = vminq_f32(t, vld1q_f32(tops + i));
+            r = vmaxq_f32(r, vld1q_f32(rights + i));
+            b = vmaxq_f32(b, vld1q_f32(bottoms + i));
+        }
+        float ls[4], ts[4], rs[4], bs[4];
+        vst1q_f32(ls, l);
+        vst1q_f32(ts, t);
+        vst1q_f32(rs, r);
+        vst1q_f32(bs, b);
+        left = *std::min_element(ls, ls + 4);
+        top = *std::min_element(ts, ts + 4);
+        right = *std::max_element(rs, rs + 4);
+        bottom = *std::max_element(bs, bs + 4);
+    }
+#endif
+    for (; i < n; i++) {
+        left = std::min(left, lefts[i]);
+        top = std::min(top, tops[i]);
+        right = std::max(right, rights[i]);
+        bottom = std::max(bottom, bottoms[i]);
+    }
+    MinikinRect joined;
+    joined.mLeft = left;
+    joined.mTop = top;
+    joined.mRight = right;
+    joined.mBottom = bottom;
+    rect->join(joined);
+}
+
+}  // namespace android
@@ -0,0 +1,40 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_GLYPH_KERNELS_H
+#define MINIKIN_GLYPH_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include <minikin/MinikinFont.h>
+
+namespace android {
+
+// Loops over the glyph arrays of a layout. They use SSE2 or NEON when the target has it, and a
+// scalar loop otherwise.
+
+// dst[i] = src[i] + offset for i < n. dst and src may be the same array.
+void offsetPositions(float* dst, const float* src, float offset, size_t n);
+
+// Join the n rectangles given as separate edge arrays into rect. The rectangles must not be
+// empty.
+void joinRects(const float* lefts, const float* tops, const float* rights, const float* bottoms,
+        size_t n, MinikinRect* rect);
+
+}  // namespace android
+
+#endif  // MINIKIN_GLYPH_KERNELS_H
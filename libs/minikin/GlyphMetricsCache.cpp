@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "GlyphMetricsCache.h"
+
+#include <algorithm>
+#include <string.h>
+
+namespace android {
+
+const size_t GlyphMetricsCache::kCapacity;
+const size_t GlyphMetricsCache::kMaxProbe;
+
+static uint32_t floatBits(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static uint8_t fakeryBits(FontFakery fakery) {
+    return (fakery.isFakeBold() ? 1 : 0) | (fakery.isFakeItalic() ? 2 : 0);
+}
+
+static uint32_t mix(uint32_t hash, uint32_t value) {
+    hash ^= value;
+    hash *= 0x9E3779B1;
+    return hash ^ (hash >> 15);
+}
+
+void GlyphMetricsCache::dropPurgedFonts() {
+    mPurgedFontIds.clear();
+    if (!getPurgedHbFonts(&mPurgeCursor, &mPurgedFontIds)) {
+        std::vector<Entry>().swap(mEntries);
+        return;
+    }
+    if (mPurgedFontIds.empty() || mEntries.empty()) {
+        return;
+    }
+    for (Entry& entry : mEntries) {
+        if ((entry.flags & kUsed) && std::find(mPurgedFontIds.begin(), mPurgedFontIds.end(),
+                entry.fontId) != mPurgedFontIds.end()) {
+            entry.flags = 0;
+        }
+    }
+}
+
+GlyphMetricsCache::Entry* GlyphMetricsCache::lookup(uint32_t glyphId, const MinikinPaint& paint) {
+    dropPurgedFonts();
+    if (mEntries.empty()) {
+        mEntries.assign(kCapacity, Entry());
+    }
+
+    const int32_t fontId = paint.font->GetUniqueId();
+    const uint8_t fakery = fakeryBits(paint.fakery);
+    uint32_t hash = mix(static_cast<uint32_t>(fontId), glyphId);
+    hash = mix(hash, floatBits(paint.size));
+    hash = mix(hash, floatBits(paint.scaleX));
+
+    const size_t home = hash & (kCapacity - 1);
+    Entry* slot = nullptr;
+    for (size_t probe = 0; probe < kMaxProbe; probe++) {
+        Entry* entry = &mEntries[(home + probe) & (kCapacity - 1)];
+        if (!(entry->flags & kUsed)) {
+            slot = entry;
+            break;
+        }
+        if (entry->fontId == fontId && entry->glyphId == glyphId && entry->size == paint.size
+                && entry->scaleX == paint.scaleX && entry->skewX == paint.skewX
+                && entry->paintFlags == paint.paintFlags && entry->fakery == fakery) {
+            return entry;
+        }
+    }
+    if (slot == nullptr) {
+        // The neighborhood is full; replace the entry in the home slot.
+        slot = &mEntries[home];
+    }
+    slot->fontId = fontId;
+    slot->glyphId = glyphId;
+    slot->size = paint.size;
+    slot->scaleX = paint.scaleX;
+    slot->skewX = paint.skewX;
+    slot->paintFlags = paint.paintFlags;
+    slot->fakery = fakery;
+    slot->flags = kUsed;
+    return slot;
+}
+
+float GlyphMetricsCache::getHorizontalAdvance(uint32_t glyphId, const MinikinPaint& paint) {
+    Entry* entry = lookup(glyphId, paint);
+    if (!(entry->flags & kHasAdvance)) {
+        entry->advance = paint.font->GetHorizontalAdvance(glyphId, paint);
+        entry->flags |= kHasAdvance;
+    }
+    return entry->advance;
+}
+
+void GlyphMetricsCache::getBounds(MinikinRect* bounds, uint32_t glyphId,
+        const MinikinPaint& paint) {
+    Entry* entry = lookup(glyphId, paint);
+    if (!(entry->flags & kHasBounds)) {
+        paint.font->GetBounds(&entry->bounds, glyphId, paint);
+        entry->flags |= kHasBounds;
+    }
+    bounds->set(entry->bounds);
+}
+
+}  // namespace android
@@ -0,0 +1,83 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_GLYPH_METRICS_CACHE_H
+#define MINIKIN_GLYPH_METRICS_CACHE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <minikin/MinikinFont.h>
+
+#include "HbFontCache.h"
+
+namespace android {
+
+// Caches glyph advances and bounds returned by MinikinFont, keyed by the font's unique id, the
+// paint attributes that affect metrics (size, scaleX, skewX, paintFlags, fakery) and the glyph id.
+//
+// The cache is a small open-addressed table that is not thread-safe; each LayoutContext owns one,
+// so every thread has its own (about 100KB once used). The entries of a font are dropped when it
+// is purged from the hb_font_t cache (see getPurgedHbFonts), since its id may then be reused, and
+// the whole table is freed after purgeHbFontCache.
+class GlyphMetricsCache {
+public:
+    GlyphMetricsCache() {}
+
+    // paint.font must be set.
+    float getHorizontalAdvance(uint32_t glyphId, const MinikinPaint& paint);
+    void getBounds(MinikinRect* bounds, uint32_t glyphId, const MinikinPaint& paint);
+
+private:
+    enum {
+        kUsed = 1 << 0,
+        kHasAdvance = 1 << 1,
+        kHasBounds = 1 << 2,
+    };
+
+    struct Entry {
+        int32_t fontId;
+        uint32_t glyphId;
+        float size;
+        float scaleX;
+        float skewX;
+        uint32_t paintFlags;
+        uint8_t fakery;
+        uint8_t flags;
+        float advance;
+        MinikinRect bounds;
+    };
+
+    // Must be a power of two.
+    static const size_t kCapacity = 2048;
+    // Number of slots probed before an existing entry is overwritten.
+    static const size_t kMaxProbe = 8;
+
+    // Returns the entry for the glyph, claiming a slot for it if it is not cached yet.
+    Entry* lookup(uint32_t glyphId, const MinikinPaint& paint);
+
+    // Drops the entries of fonts purged since the last call.
+    void dropPurgedFonts();
+
+    // Allocated on first use.
+    std::vector<Entry> mEntries;
+    HbFontPurgeCursor mPurgeCursor;
+    std::vector<int32_t> mPurgedFontIds;  // scratch for dropPurgedFonts
+};
+
+}  // namespace android
+
+#endif  // MINIKIN_GLYPH_METRICS_CACHE_H
@@ -18,14 +18,18 @@
 
 #include "HbFontCache.h"
 
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
 #include <log/log.h>
 #include <utils/LruCache.h>
 
 #include <hb.h>
 #include <hb-ot.h>
 
+#include <minikin/Layout.h>
 #include <minikin/MinikinFont.h>
-#include "MinikinInternal.h"
 
 namespace android {
 
@@ -47,7 +51,7 @@ static hb_blob_t* referenceTable(hb_face_t* /* face */, hb_tag_t tag, void* user
 
 class HbFontCache : private OnEntryRemoved<int32_t, hb_font_t*> {
 public:
-    HbFontCache() : mCache(kMaxEntries) {
+    HbFontCache() : mHits(0), mMisses(0), mEvictions(0), mMissNanos(0), mCache(kMaxEntries) {
         mCache.setOnEntryRemovedListener(this);
     }
 
@@ -61,9 +65,28 @@ public:
     }
 
     void put(int32_t fontId, hb_font_t* font) {
+        if (mCache.size() >= kMaxEntries) {
+            mEvictions++;
+        }
         mCache.put(fontId, font);
     }
 
+    void getStats(CacheStats* stats) {
+        *stats = CacheStats();
+        stats->hits = mHits;
+        stats->misses = mMisses;
+        stats->evictions = mEvictions;
+        stats->entries = mCache.size();
+        stats->missNanos = mMissNanos;
+    }
+
+    void resetStats() {
+        mHits = 0;
+        mMisses = 0;
+        mEvictions = 0;
+        mMissNanos = 0;
+    }
+
     void clear() {
         mCache.clear();
     }
@@ -72,51 +95,96 @@ public:
         mCache.remove(fontId);
     }
 
+    // Guards mCache. Held for the whole lookup-or-create sequence in getHbFont so that a font is
+    // never created twice.
+    std::mutex mMutex;
+
+    // Statistics, guarded by mMutex.
+    uint64_t mHits;
+    uint64_t mMisses;
+    uint64_t mEvictions;
+    uint64_t mMissNanos;
+
 private:
     static const size_t kMaxEntries = 100;
 
     LruCache<int32_t, hb_font_t*> mCache;
 };
 
-HbFontCache* getFontCacheLocked() {
-    assertMinikinLocked();
-    static HbFontCache* cache = nullptr;
-    if (cache == nullptr) {
-        cache = new HbFontCache();
-    }
+static std::atomic<uint32_t> gHbFontGeneration(0);
+
+// Ring of the ids passed to the most recent purgeHbFont calls. Writers are serialized by the cache
+// mutex. gPurgeBegin is advanced before a slot is overwritten and gPurgeEnd after, so a reader
+// that sees gPurgeBegin within kPurgeLogSize of its cursor after reading knows that the slots it
+// read were not overwritten.
+static const uint32_t kPurgeLogSize = 64;
+static std::atomic<int32_t> gPurgedFontIds[kPurgeLogSize];
+static std::atomic<uint32_t> gPurgeBegin(0);
+static std::atomic<uint32_t> gPurgeEnd(0);
+
+static HbFontCache* getFontCache() {
+    static HbFontCache* cache = new HbFontCache();
     return cache;
 }
 
-void purgeHbFontCacheLocked() {
-    assertMinikinLocked();
-    getFontCacheLocked()->clear();
+void purgeHbFontCache() {
+    HbFontCache* fontCache = getFontCache();
+    std::lock_guard<std::mutex> _l(fontCache->mMutex);
+    fontCache->clear();
+    gHbFontGeneration.fetch_add(1, std::memory_order_relaxed);
 }
 
-void purgeHbFontLocked(const MinikinFont* minikinFont) {
-    assertMinikinLocked();
+void purgeHbFont(const MinikinFont* minikinFont) {
+    HbFontCache* fontCache = getFontCache();
     const int32_t fontId = minikinFont->GetUniqueId();
-    getFontCacheLocked()->remove(fontId);
+    std::lock_guard<std::mutex> _l(fontCache->mMutex);
+    fontCache->remove(fontId);
+    const uint32_t count = gPurgeEnd.load(std::memory_order_relaxed);
+    gPurgeBegin.store(count + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    gPurgedFontIds[count % kPurgeLogSize].store(fontId, std::memory_order_relaxed);
+    gPurgeEnd.store(count + 1, std::memory_order_release);
+}
+
+bool getPurgedHbFonts(HbFontPurgeCursor* cursor, std::vector<int32_t>* purgedFontIds) {
+    const uint32_t generation = gHbFontGeneration.load(std::memory_order_relaxed);
+    const uint32_t end = gPurgeEnd.load(std::memory_order_acquire);
+    if (generation == cursor->generation && end == cursor->purgeCount) {
+        return true;
+    }
+    bool complete = generation == cursor->generation && end - cursor->purgeCount <= kPurgeLogSize;
+    if (complete) {
+        for (uint32_t i = cursor->purgeCount; i != end; i++) {
+            purgedFontIds->push_back(
+                    gPurgedFontIds[i % kPurgeLogSize].load(std::memory_order_relaxed));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        complete = gPurgeBegin.load(std::memory_order_relaxed) - cursor->purgeCount
+                <= kPurgeLogSize;
+    }
+    cursor->generation = generation;
+    cursor->purgeCount = end;
+    return complete;
 }
 
 // Returns a new reference to a hb_font_t object, caller is
 // responsible for calling hb_font_destroy() on it.
-hb_font_t* getHbFontLocked(MinikinFont* minikinFont) {
-    assertMinikinLocked();
+hb_font_t* getHbFont(MinikinFont* minikinFont) {
     // TODO: get rid of nullFaceFont
-    static hb_font_t* nullFaceFont = nullptr;
+    static hb_font_t* nullFaceFont = hb_font_create(nullptr);
     if (minikinFont == nullptr) {
-        if (nullFaceFont == nullptr) {
-            nullFaceFont = hb_font_create(nullptr);
-        }
         return hb_font_reference(nullFaceFont);
     }
 
-    HbFontCache* fontCache = getFontCacheLocked();
+    HbFontCache* fontCache = getFontCache();
     const int32_t fontId = minikinFont->GetUniqueId();
+    std::lock_guard<std::mutex> _l(fontCache->mMutex);
     hb_font_t* font = fontCache->get(fontId);
     if (font != nullptr) {
+        fontCache->mHits++;
         return hb_font_reference(font);
     }
+    const auto missStart = std::chrono::steady_clock::now();
 
     hb_face_t* face;
     const void* buf = minikinFont->GetFontData();
@@ -138,8 +206,25 @@ hb_font_t* getHbFontLocked(MinikinFont* minikinFont) {
     font = hb_font_create_sub_font(parent_font);
     hb_font_destroy(parent_font);
     hb_face_destroy(face);
+    // Cached fonts are shared by all threads, so nobody may modify them.
+    hb_font_make_immutable(font);
     fontCache->put(fontId, font);
+    fontCache->mMisses++;
+    fontCache->mMissNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - missStart).count();
     return hb_font_reference(font);
 }
 
+void getHbFontCacheStats(CacheStats* stats) {
+    HbFontCache* fontCache = getFontCache();
+    std::lock_guard<std::mutex> _l(fontCache->mMutex);
+    fontCache->getStats(stats);
+}
+
+void resetHbFontCacheStats() {
+    HbFontCache* fontCache = getFontCache();
+    std::lock_guard<std::mutex> _l(fontCache->mMutex);
+    fontCache->resetStats();
+}
+
 }  // namespace android
@@ -17,14 +17,37 @@
 #ifndef MINIKIN_HBFONT_CACHE_H
 #define MINIKIN_HBFONT_CACHE_H
 
+#include <stdint.h>
+#include <vector>
+
 struct hb_font_t;
 
 namespace android {
 class MinikinFont;
+struct CacheStats;
+
+// The cache has its own lock; these functions may be called from any thread.
+// The returned hb_font_t objects are immutable and can be shared between threads. Callers that
+// need to set font funcs, scale or ppem must create a sub font with hb_font_create_sub_font().
+void purgeHbFontCache();
+void purgeHbFont(const MinikinFont* minikinFont);
+hb_font_t* getHbFont(MinikinFont* minikinFont);
+
+// Per-thread caches that are keyed by font id keep a cursor into the log of purged fonts, so that
+// they drop the entries of a destroyed font before its id can be reused.
+struct HbFontPurgeCursor {
+    HbFontPurgeCursor() : generation(0), purgeCount(0) {}
+    uint32_t generation;  // purgeHbFontCache calls seen
+    uint32_t purgeCount;  // purgeHbFont calls seen
+};
 
-void purgeHbFontCacheLocked();
-void purgeHbFontLocked(const MinikinFont* minikinFont);
-hb_font_t* getHbFontLocked(MinikinFont* minikinFont);
+// Appends the ids of the fonts purged by purgeHbFont since the cursor was last advanced to
+// purgedFontIds, and advances it. Returns false if the caller must drop all of its entries
+// instead, which happens after purgeHbFontCache or when the cursor fell too far behind.
+// Lock-free, and only two atomic loads when nothing was purged.
+bool getPurgedHbFonts(HbFontPurgeCursor* cursor, std::vector<int32_t>* purgedFontIds);
+void getHbFontCacheStats(CacheStats* stats);
+void resetHbFontCacheStats();
 
 }  // namespace android
 #endif  // MINIKIN_HBFONT_CACHE_H
@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_INTERN_TABLE_H
+#define MINIKIN_INTERN_TABLE_H
+
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <unordered_map>
+
+#include <log/log.h>
+
+namespace android {
+
+// Maps strings to dense IDs and IDs to values parsed from those strings, so that caches can key on
+// a small ID instead of the string. Used by FontLanguageListCache and FontFeatureSettingsCache.
+//
+// Values are stored in chunks of doubling size which are never moved or freed, so getById reads
+// them without a lock and the returned references stay valid for the lifetime of the table. The
+// string lookup is split into shards with their own locks, so threads looking up different
+// strings rarely contend; the shared append lock is only taken for strings seen for the first
+// time.
+template <typename T>
+class InternTable {
+public:
+    // Returned by find and insert when the string is not interned.
+    static const uint32_t kNotInterned = UINT32_MAX;
+
+    // At most maxSize values are stored; after that insert returns kNotInterned.
+    explicit InternTable(uint32_t maxSize) : mChunks(), mSize(0), mMaxSize(maxSize) {}
+
+    // Returns the ID of the string, or kNotInterned if it has not been inserted.
+    uint32_t find(const std::string& key) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> _l(shard.mutex);
+        auto it = shard.ids.find(key);
+        return it == shard.ids.end() ? kNotInterned : it->second;
+    }
+
+    // Stores the value for the string and returns its ID. If another thread inserted the same
+    // string first, its ID is returned instead and value is dropped. Returns kNotInterned when
+    // the table is full.
+    uint32_t insert(const std::string& key, T&& value) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> _l(shard.mutex);
+        auto it = shard.ids.find(key);
+        if (it != shard.ids.end()) {
+            return it->second;
+        }
+        const uint32_t id = append(std::move(value));
+        if (id != kNotInterned) {
+            shard.ids.insert(std::make_pair(key, id));
+        }
+        return id;
+    }
+
+    // Stores a value that no string maps to, e.g. the empty entry with ID 0.
+    uint32_t append(T&& value) {
+        std::lock_guard<std::mutex> _l(mAppendMutex);
+        const uint32_t id = mSize.load(std::memory_order_relaxed);
+        if (id >= mMaxSize) {
+            return kNotInterned;
+        }
+        size_t chunkIndex;
+        size_t offset;
+        locate(id, &chunkIndex, &offset);
+        T* chunk = mChunks[chunkIndex].load(std::memory_order_relaxed);
+        if (chunk == nullptr) {
+            chunk = new T[getChunkSize(chunkIndex)];
+            mChunks[chunkIndex].store(chunk, std::memory_order_relaxed);
+        }
+        chunk[offset] = std::move(value);
+        // Publish with release semantics, so that a reader which observes an ID also observes
+        // its value.
+        mSize.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    // Lock-free.
+    const T& getById(uint32_t id) const {
+        LOG_ALWAYS_FATAL_IF(id >= mSize.load(std::memory_order_acquire),
+                "Lookup by unknown interned ID.");
+        size_t chunkIndex;
+        size_t offset;
+        locate(id, &chunkIndex, &offset);
+        return mChunks[chunkIndex].load(std::memory_order_relaxed)[offset];
+    }
+
+private:
+    // Chunk i holds 2^(kLogFirstChunkSize + i) values, which is enough chunks for every 32 bit ID.
+    static const int kLogFirstChunkSize = 6;
+    static const size_t kMaxChunks = 33 - kLogFirstChunkSize;
+    static const size_t kShardCount = 8;
+
+    static size_t getChunkSize(size_t chunkIndex) {
+        return static_cast<size_t>(1) << (kLogFirstChunkSize + chunkIndex);
+    }
+
+    static void locate(uint32_t id, size_t* chunkIndex, size_t* offset) {
+        const uint64_t pos = static_cast<uint64_t>(id) + (1u << kLogFirstChunkSize);
+        const int log = 63 - __builtin_clzll(pos);
+        *chunkIndex = log - kLogFirstChunkSize;
+        *offset = pos - (static_cast<uint64_t>(1) << log);
+    }
+
+    struct Shard {
+        std::mutex mutex;  // guards ids
+        std::unordered_map<std::string, uint32_t> ids;
+    };
+
+    Shard& getShard(const std::string& key) {
+        return mShards[std::hash<std::string>()(key) % kShardCount];
+    }
+
+    Shard mShards[kShardCount];
+
+    std::mutex mAppendMutex;  // serializes append
+    std::atomic<T*> mChunks[kMaxChunks];
+    std::atomic<uint32_t> mSize;
+    const uint32_t mMaxSize;
+};
+
+template <typename T>
+const uint32_t InternTable<T>::kNotInterned;
+
+}  // namespace android
+
+#endif  // MINIKIN_INTERN_TABLE_H
@@ -0,0 +1,233 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "ItemizeCache.h"
+
+#include <memory>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#include <log/log.h>
+#include <utils/JenkinsHash.h>
+
+#include "LayoutUtils.h"
+#include "ShardedLruCache.h"
+
+namespace android {
+
+// The runs of one itemized text, with the copy of the text that the cache key points to. Both
+// arrays follow the header in the same allocation, the runs first since they have the stricter
+// alignment.
+class ItemizeCacheEntry {
+public:
+    static ItemizeCacheEntry* create(const uint16_t* text, size_t count,
+            const FontCollection::Run* runs, size_t runCount) {
+        const size_t bytes = getAllocationSize(count, runCount);
+        void* block = malloc(bytes);
+        LOG_ALWAYS_FATAL_IF(block == nullptr, "failed to allocate %zu bytes for itemize runs",
+                bytes);
+        ItemizeCacheEntry* entry = new (block) ItemizeCacheEntry();
+        entry->mRunCount = runCount;
+        uint8_t* base = static_cast<uint8_t*>(block);
+        std::uninitialized_copy(runs, runs + runCount,
+                reinterpret_cast<FontCollection::Run*>(base + getRunsOffset()));
+        if (count > 0) {
+            memcpy(base + entry->getTextOffset(), text, count * sizeof(uint16_t));
+        }
+        return entry;
+    }
+
+    // Run and the header are trivially destructible.
+    static void destroy(ItemizeCacheEntry* entry) {
+        free(entry);
+    }
+
+    // Size of the block holding an entry with count characters and runCount runs, in bytes.
+    static size_t getAllocationSize(size_t count, size_t runCount) {
+        return getRunsOffset() + runCount * sizeof(FontCollection::Run)
+                + count * sizeof(uint16_t);
+    }
+
+    size_t getRunCount() const {
+        return mRunCount;
+    }
+
+    const FontCollection::Run* getRuns() const {
+        return reinterpret_cast<const FontCollection::Run*>(at(getRunsOffset()));
+    }
+
+    const uint16_t* getText() const {
+        return reinterpret_cast<const uint16_t*>(at(getTextOffset()));
+    }
+
+private:
+    ItemizeCacheEntry() {}
+
+    static size_t getRunsOffset() {
+        return (sizeof(ItemizeCacheEntry) + alignof(FontCollection::Run) - 1)
+                & ~(alignof(FontCollection::Run) - 1);
+    }
+
+    size_t getTextOffset() const {
+        return getRunsOffset() + mRunCount * sizeof(FontCollection::Run);
+    }
+
+    const uint8_t* at(size_t offset) const {
+        return reinterpret_cast<const uint8_t*>(this) + offset;
+    }
+
+    uint32_t mRunCount;
+
+    // disallow copy and assign
+    ItemizeCacheEntry(const ItemizeCacheEntry&);
+    void operator=(const ItemizeCacheEntry&);
+};
+
+class ItemizeCacheKey {
+public:
+    ItemizeCacheKey(const FontCollection* collection, FontStyle style, const uint16_t* text,
+            size_t count)
+            : mText(text), mCount(count), mId(collection->getId()), mStyle(style),
+            mHash(computeHash()) {
+    }
+
+    bool operator==(const ItemizeCacheKey& other) const {
+        return mId == other.mId
+                && mStyle == other.mStyle
+                && mCount == other.mCount
+                && !memcmp(mText, other.mText, mCount * sizeof(uint16_t));
+    }
+
+    hash_t hash() const {
+        return mHash;
+    }
+
+    const uint16_t* getText() const {
+        return mText;
+    }
+
+    size_t getTextLength() const {
+        return mCount;
+    }
+
+    // Point the key at a copy of its text owned by a cache entry.
+    void setText(const uint16_t* text) {
+        mText = text;
+    }
+
+private:
+    hash_t computeHash() const {
+        uint32_t hash = JenkinsHashMix(0, mId);
+        hash = JenkinsHashMix(hash, hash_type(mStyle));
+        hash = JenkinsHashMix(hash, hashText(mText, mCount));
+        return JenkinsHashWhiten(hash);
+    }
+
+    const uint16_t* mText;
+    size_t mCount;
+    uint32_t mId;  // for the font collection
+    FontStyle mStyle;
+    hash_t mHash;
+};
+
+hash_t hash_type(const ItemizeCacheKey& key) {
+    return key.hash();
+}
+
+// Entries own a copy of the text that their key points to.
+struct ItemizeCachePolicy {
+    // Heap footprint of a cache entry: its block, plus the LruCache node holding the key, the
+    // entry pointer and two list links, and the hash set node and bucket that index it.
+    static size_t getMemoryUsage(size_t textLength, size_t runCount) {
+        return ItemizeCacheEntry::getAllocationSize(textLength, runCount)
+                + sizeof(ItemizeCacheKey) + sizeof(ItemizeCacheEntry*) + 2 * sizeof(void*)
+                + 4 * sizeof(void*);
+    }
+
+    static size_t getMemoryUsage(const ItemizeCacheKey& key, ItemizeCacheEntry* const& entry) {
+        return getMemoryUsage(key.getTextLength(), entry->getRunCount());
+    }
+
+    static void onEntryRemoved(ItemizeCacheKey& key, ItemizeCacheEntry*& entry) {
+        key.setText(nullptr);
+        ItemizeCacheEntry::destroy(entry);
+    }
+};
+
+// Disabled until a budget is set.
+class ItemizeCache
+        : public ShardedLruCache<ItemizeCacheKey, ItemizeCacheEntry*, ItemizeCachePolicy> {
+public:
+    ItemizeCache() : ShardedLruCache(0) {
+    }
+
+    bool isEnabled() const {
+        return getMaxBytes() != 0;
+    }
+
+    // Appends the cached runs for the key to result. Returns false on a cache miss.
+    bool get(const ItemizeCacheKey& key, std::vector<FontCollection::Run>* result) {
+        return ShardedLruCache::get(key, [result](ItemizeCacheEntry* entry) {
+            result->insert(result->end(), entry->getRuns(),
+                    entry->getRuns() + entry->getRunCount());
+        });
+    }
+
+    void put(ItemizeCacheKey& key, const FontCollection::Run* runs, size_t runCount) {
+        const size_t bytes = ItemizeCachePolicy::getMemoryUsage(key.getTextLength(), runCount);
+        // The statistics of this cache are not reported, so the miss is not timed.
+        ShardedLruCache::put(key, bytes, 0, [runs, runCount](ItemizeCacheKey* cachedKey) {
+            ItemizeCacheEntry* entry = ItemizeCacheEntry::create(cachedKey->getText(),
+                    cachedKey->getTextLength(), runs, runCount);
+            cachedKey->setText(entry->getText());
+            return entry;
+        });
+    }
+};
+
+static ItemizeCache* getItemizeCache() {
+    static ItemizeCache* cache = new ItemizeCache();
+    return cache;
+}
+
+void itemizeCached(const FontCollection* collection, const uint16_t* text, size_t count,
+        FontStyle style, std::vector<FontCollection::Run>* result) {
+    ItemizeCache* cache = getItemizeCache();
+    if (count == 0 || !cache->isEnabled()) {
+        collection->itemize(text, count, style, result);
+        return;
+    }
+    ItemizeCacheKey key(collection, style, text, count);
+    if (cache->get(key, result)) {
+        return;
+    }
+    const size_t firstRun = result->size();
+    collection->itemize(text, count, style, result);
+    cache->put(key, result->data() + firstRun, result->size() - firstRun);
+}
+
+void setItemizeCacheMaxBytes(size_t maxBytes) {
+    getItemizeCache()->setMaxBytes(maxBytes);
+}
+
+void purgeItemizeCache() {
+    getItemizeCache()->clear();
+}
+
+}  // namespace android
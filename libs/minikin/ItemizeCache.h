@@ -0,0 +1,42 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_ITEMIZE_CACHE_H
+#define MINIKIN_ITEMIZE_CACHE_H
+
+#include <stdint.h>
+#include <vector>
+
+#include <minikin/FontCollection.h>
+
+namespace android {
+
+// The cache has its own locks; these functions may be called from any thread.
+// Itemization only depends on the collection, the style and the text, so words that are shaped
+// with different paints or hyphen edits share their font fallback results through it.
+
+// Same as collection->itemize(), but reuses the runs of an earlier call with the same collection,
+// style and text when the cache is enabled. Collection ids are never reused, so entries of
+// destroyed collections can never match again and are simply aged out.
+void itemizeCached(const FontCollection* collection, const uint16_t* text, size_t count,
+        FontStyle style, std::vector<FontCollection::Run>* result);
+
+// Set the memory budget of the cache, in bytes. 0 disables the cache, which is the default.
+void setItemizeCacheMaxBytes(size_t maxBytes);
+void purgeItemizeCache();
+
+}  // namespace android
+#endif  // MINIKIN_ITEMIZE_CACHE_H
@@ -17,25 +17,38 @@
 #define LOG_TAG "Minikin"
 
 #include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <fstream>
 #include <iostream>  // for debugging
 #include <math.h>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <unicode/ubidi.h>
 #include <vector>
 
 #include <log/log.h>
 #include <utils/JenkinsHash.h>
-#include <utils/LruCache.h>
 
 #include <hb-icu.h>
 #include <hb-ot.h>
 
+#include "FontFeatureSettingsCache.h"
 #include "FontLanguage.h"
 #include "FontLanguageListCache.h"
+#include "GlyphKernels.h"
+#include "GlyphMetricsCache.h"
 #include "HbFontCache.h"
+#include "ItemizeCache.h"
+#include "LayoutPiece.h"
 #include "LayoutUtils.h"
 #include "MinikinInternal.h"
+#include "ScratchArena.h"
+#include "ShardedLruCache.h"
+#include "ThreadPool.h"
+#include "Utf8Utils.h"
 #include <minikin/MinikinFontFreeType.h>
 #include <minikin/Layout.h>
 
@@ -88,31 +101,97 @@ namespace android {
 
 const int kDirection_Mask = 0x1;
 
+// Layout state and scratch buffers. Each thread owns one context (see ScopedLayoutContext),
+// so shaping needs no shared mutable state, and the buffers keep their capacity between calls.
 struct LayoutContext {
+    LayoutContext();
+    ~LayoutContext();
+
     MinikinPaint paint;
     FontStyle style;
-    std::vector<hb_font_t*> hbFonts;  // parallel to mFaces
-
-    void clearHbFonts() {
-        for (size_t i = 0; i < hbFonts.size(); i++) {
-            hb_font_set_funcs(hbFonts[i], nullptr, nullptr, nullptr);
-            hb_font_destroy(hbFonts[i]);
+    uint32_t featureSettingsId;  // interned paint.fontFeatureSettings
+    hb_buffer_t* buffer;
+    std::vector<hb_font_t*> hbFonts;  // parallel to mFaces, owned by hbFontPool
+    std::vector<FontCollection::Run> items;
+    std::vector<hb_feature_t> features;
+    GlyphMetricsCache glyphMetrics;
+    Layout wordLayout;  // scratch layout for shaping a single word
+    Utf8Transcoder utf8Transcoder;  // UTF-16 copy of the text for the UTF-8 entry points
+    std::vector<float> utf16Advances;
+    std::vector<float> glyphBounds;  // scratch for Layout::getBounds
+    UBiDi* bidi = nullptr;  // reused by BidiText, see getBidi()
+    ScratchArena arena;  // reset at the end of each top-level layout call
+    bool inUse = false;
+
+    // Returns an hb_font_t for the font with our font funcs, ppem and scale set up for the current
+    // paint size and scaleX. Fonts are kept in hbFontPool and reused by later calls.
+    hb_font_t* getPooledHbFont(MinikinFont* font);
+
+    // ICU keeps the memory of a UBiDi object between ubidi_setPara calls, so one object is
+    // opened per context and reused.
+    UBiDi* getBidi() {
+        if (bidi == nullptr) {
+            bidi = ubidi_open();
+            if (bidi == nullptr) {
+                ALOGE("error creating bidi object");
+            }
         }
-        hbFonts.clear();
+        return bidi;
     }
+
+    // Called before shaping a word and at the end of each layout call, when no pooled font is in
+    // use. Drops the pooled fonts of fonts purged since the pool was filled.
+    void clearHbFonts();
+
+private:
+    struct PooledHbFont {
+        MinikinFont* font;
+        int32_t fontId;
+        float size;
+        float scaleX;
+        hb_font_t* hbFont;
+    };
+
+    static const size_t kMaxPooledHbFonts = 16;
+
+    void destroyHbFontPool();
+    static void destroyPooledHbFont(const PooledHbFont& pooled);
+
+    std::vector<PooledHbFont> hbFontPool;
+    HbFontPurgeCursor hbFontPurgeCursor;
+    std::vector<int32_t> purgedFontIds;  // scratch for clearHbFonts
 };
 
 // Layout cache datatypes
 
+// HarfBuzz looks at no more than HB_BUFFER_CONTEXT_LENGTH (5) code points of context on either side
+// of the text being shaped, and the constant is not exported. Keep twice as many UTF-16 units so
+// that surrogate pairs are covered.
+static const size_t kMaxContextUnits = 2 * 5;
+
+static size_t getContextStart(size_t start) {
+    return start > kMaxContextUnits ? start - kMaxContextUnits : 0;
+}
+
+static size_t getContextEnd(size_t start, size_t count, size_t nchars) {
+    return std::min(nchars, start + count + kMaxContextUnits);
+}
+
 class LayoutCacheKey {
 public:
+    // Only the part of the context that can affect shaping is kept in the key, so that long
+    // unbroken runs do not have to be hashed, compared and copied in full for every word.
     LayoutCacheKey(const FontCollection* collection, const MinikinPaint& paint, FontStyle style,
-            const uint16_t* chars, size_t start, size_t count, size_t nchars, bool dir)
-            : mChars(chars), mNchars(nchars),
-            mStart(start), mCount(count), mId(collection->getId()), mStyle(style),
+            uint32_t featureSettingsId, const uint16_t* chars, size_t start, size_t count,
+            size_t nchars, bool dir)
+            : mChars(chars + getContextStart(start)),
+            mNchars(getContextEnd(start, count, nchars) - getContextStart(start)),
+            mStart(start - getContextStart(start)), mCount(count), mId(collection->getId()),
+            mStyle(style),
             mSize(paint.size), mScaleX(paint.scaleX), mSkewX(paint.skewX),
             mLetterSpacing(paint.letterSpacing),
-            mPaintFlags(paint.paintFlags), mHyphenEdit(paint.hyphenEdit), mIsRtl(dir),
+            mPaintFlags(paint.paintFlags), mFeatureSettingsId(featureSettingsId),
+            mHyphenEdit(paint.hyphenEdit), mIsRtl(dir),
             mHash(computeHash()) {
     }
     bool operator==(const LayoutCacheKey &other) const;
@@ -121,17 +200,24 @@ public:
         return mHash;
     }
 
-    void copyText() {
-        uint16_t* charsCopy = new uint16_t[mNchars];
-        memcpy(charsCopy, mChars, mNchars * sizeof(uint16_t));
-        mChars = charsCopy;
+    size_t getTextLength() const {
+        return mNchars;
+    }
+
+    // Point the key at a copy of its text owned by a cache entry.
+    void setText(const uint16_t* chars) {
+        mChars = chars;
     }
-    void freeText() {
-        delete[] mChars;
-        mChars = NULL;
+
+    // Shape the word into a new piece, using ctx->wordLayout as scratch space.
+    LayoutPiece* createPiece(LayoutContext* ctx, const FontCollection* collection) const {
+        Layout* layout = &ctx->wordLayout;
+        doLayout(layout, ctx, collection);
+        return LayoutPiece::create(*layout, mChars, mNchars);
     }
 
     void doLayout(Layout* layout, LayoutContext* ctx, const FontCollection* collection) const {
+        layout->reset();
         layout->setFontCollection(collection);
         layout->mAdvances.resize(mCount, 0);
         ctx->clearHbFonts();
@@ -150,6 +236,7 @@ private:
     float mSkewX;
     float mLetterSpacing;
     int32_t mPaintFlags;
+    uint32_t mFeatureSettingsId;
     HyphenEdit mHyphenEdit;
     bool mIsRtl;
     // Note: any fields added to MinikinPaint must also be reflected here.
@@ -159,41 +246,52 @@ private:
     hash_t computeHash() const;
 };
 
-class LayoutCache : private OnEntryRemoved<LayoutCacheKey, Layout*> {
-public:
-    LayoutCache() : mCache(kMaxEntries) {
-        mCache.setOnEntryRemovedListener(this);
+// Entries hold a reference to their piece, which also owns the text that the key points to.
+struct LayoutCachePolicy {
+    // Approximate heap footprint of a cache entry, including the LruCache bookkeeping.
+    static size_t getMemoryUsage(const LayoutCacheKey& /* key */, LayoutPiece* const& piece) {
+        return sizeof(LayoutCacheKey) + 4 * sizeof(void*) + piece->getMemoryUsage();
     }
 
-    void clear() {
-        mCache.clear();
+    // The key text lives in the piece, which stays alive as long as a caller holds a ref.
+    static void onEntryRemoved(LayoutCacheKey& key, LayoutPiece*& piece) {
+        key.setText(NULL);
+        piece->unref();
     }
+};
 
-    Layout* get(LayoutCacheKey& key, LayoutContext* ctx, const FontCollection* collection) {
-        Layout* layout = mCache.get(key);
-        if (layout == NULL) {
-            key.copyText();
-            layout = new Layout();
-            key.doLayout(layout, ctx, collection);
-            mCache.put(key, layout);
-        }
-        return layout;
+class LayoutCache : public ShardedLruCache<LayoutCacheKey, LayoutPiece*, LayoutCachePolicy> {
+public:
+    LayoutCache() : ShardedLruCache(kDefaultMaxBytes) {
     }
 
-private:
-    // callback for OnEntryRemoved
-    void operator()(LayoutCacheKey& key, Layout*& value) {
-        key.freeText();
-        delete value;
+    // Returns a new reference to the cached piece for the key, shaping the word first on a cache
+    // miss. The caller must unref() the piece.
+    LayoutPiece* getOrCreate(LayoutCacheKey& key, LayoutContext* ctx,
+            const FontCollection* collection) {
+        LayoutPiece* piece = NULL;
+        if (get(key, [&piece](LayoutPiece* cached) {
+                    cached->ref();
+                    piece = cached;
+                })) {
+            return piece;
+        }
+        // Shape without holding the lock so that other threads can use the shard meanwhile.
+        const auto missStart = std::chrono::steady_clock::now();
+        piece = key.createPiece(ctx, collection);
+        const uint64_t missNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now() - missStart).count();
+        put(key, LayoutCachePolicy::getMemoryUsage(key, piece), missNanos,
+                [piece](LayoutCacheKey* cachedKey) {
+                    cachedKey->setText(piece->getText());
+                    piece->ref();
+                    return piece;
+                });
+        return piece;
     }
 
-    LruCache<LayoutCacheKey, Layout*> mCache;
-
-    //static const size_t kMaxEntries = LruCache<LayoutCacheKey, Layout*>::kUnlimitedCapacity;
-
-    // TODO: eviction based on memory footprint; for now, we just use a constant
-    // number of strings
-    static const size_t kMaxEntries = 5000;
+private:
+    static const size_t kDefaultMaxBytes = 2 * 1024 * 1024;
 };
 
 static unsigned int disabledDecomposeCompatibility(hb_unicode_funcs_t*, hb_codepoint_t,
@@ -208,18 +306,138 @@ public:
         /* Disable the function used for compatibility decomposition */
         hb_unicode_funcs_set_decompose_compatibility_func(
                 unicodeFunctions, disabledDecomposeCompatibility, NULL, NULL);
-        hbBuffer = hb_buffer_create();
-        hb_buffer_set_unicode_funcs(hbBuffer, unicodeFunctions);
     }
 
-    hb_buffer_t* hbBuffer;
     hb_unicode_funcs_t* unicodeFunctions;
     LayoutCache layoutCache;
 
+    std::shared_ptr<ThreadPool> getThreadPool() {
+        std::lock_guard<std::mutex> _l(threadPoolMutex);
+        return threadPool;
+    }
+
+    void setThreadPool(std::shared_ptr<ThreadPool> pool) {
+        std::lock_guard<std::mutex> _l(threadPoolMutex);
+        threadPool = pool;
+    }
+
     static LayoutEngine& getInstance() {
         static LayoutEngine* instance = new LayoutEngine();
         return *instance;
     }
+
+private:
+    std::mutex threadPoolMutex;
+    std::shared_ptr<ThreadPool> threadPool;  // null unless parallel layout is enabled
+};
+
+LayoutContext::LayoutContext() {
+    buffer = hb_buffer_create();
+    hb_buffer_set_unicode_funcs(buffer, LayoutEngine::getInstance().unicodeFunctions);
+}
+
+LayoutContext::~LayoutContext() {
+    if (bidi != nullptr) {
+        ubidi_close(bidi);
+    }
+    destroyHbFontPool();
+    hb_buffer_destroy(buffer);
+}
+
+void LayoutContext::destroyPooledHbFont(const PooledHbFont& pooled) {
+    hb_font_set_funcs(pooled.hbFont, nullptr, nullptr, nullptr);
+    hb_font_destroy(pooled.hbFont);
+}
+
+void LayoutContext::destroyHbFontPool() {
+    for (const PooledHbFont& pooled : hbFontPool) {
+        destroyPooledHbFont(pooled);
+    }
+    hbFontPool.clear();
+}
+
+void LayoutContext::clearHbFonts() {
+    hbFonts.clear();
+    purgedFontIds.clear();
+    if (!getPurgedHbFonts(&hbFontPurgeCursor, &purgedFontIds)) {
+        destroyHbFontPool();
+        return;
+    }
+    if (purgedFontIds.empty()) {
+        return;
+    }
+    auto isPurged = [this](const PooledHbFont& pooled) {
+        return std::find(purgedFontIds.begin(), purgedFontIds.end(), pooled.fontId)
+                != purgedFontIds.end();
+    };
+    for (const PooledHbFont& pooled : hbFontPool) {
+        if (isPurged(pooled)) {
+            destroyPooledHbFont(pooled);
+        }
+    }
+    hbFontPool.erase(std::remove_if(hbFontPool.begin(), hbFontPool.end(), isPurged),
+            hbFontPool.end());
+}
+
+// The inputs of a LayoutContext. Parallel layout takes one before handing out work and sets up
+// the context of every chunk from it, since shaping modifies ctx->paint.
+struct LayoutContextSnapshot {
+    explicit LayoutContextSnapshot(const LayoutContext& ctx)
+            : style(ctx.style), paint(ctx.paint), featureSettingsId(ctx.featureSettingsId) {
+    }
+
+    void applyTo(LayoutContext* ctx) const {
+        ctx->style = style;
+        ctx->paint = paint;
+        ctx->featureSettingsId = featureSettingsId;
+    }
+
+    const FontStyle style;
+    const MinikinPaint paint;
+    const uint32_t featureSettingsId;
+};
+
+// Borrows the calling thread's LayoutContext for one top-level layout call. A nested call on the
+// same thread (e.g. from a MinikinFont callback) gets a temporary context instead.
+class ScopedLayoutContext {
+public:
+    ScopedLayoutContext() {
+        thread_local LayoutContext threadContext;
+        if (threadContext.inUse) {
+            mTemporary.reset(new LayoutContext());
+            mCtx = mTemporary.get();
+        } else {
+            mCtx = &threadContext;
+        }
+        mCtx->inUse = true;
+    }
+
+    ScopedLayoutContext(const FontStyle& style, const MinikinPaint& paint)
+            : ScopedLayoutContext() {
+        mCtx->style = style;
+        mCtx->paint = paint;
+        mCtx->featureSettingsId = FontFeatureSettingsCache::getId(paint.fontFeatureSettings);
+    }
+
+    // Used by worker threads to lay out with the same style and paint as the calling thread.
+    explicit ScopedLayoutContext(const LayoutContextSnapshot& snapshot) : ScopedLayoutContext() {
+        snapshot.applyTo(mCtx);
+    }
+
+    ~ScopedLayoutContext() {
+        mCtx->clearHbFonts();
+        mCtx->arena.reset();
+        mCtx->inUse = false;
+    }
+
+    LayoutContext* get() const { return mCtx; }
+
+private:
+    LayoutContext* mCtx;
+    std::unique_ptr<LayoutContext> mTemporary;
+
+    ScopedLayoutContext(const ScopedLayoutContext&) = delete;
+    void operator=(const ScopedLayoutContext&) = delete;
 };
 
 bool LayoutCacheKey::operator==(const LayoutCacheKey& other) const {
@@ -232,6 +450,7 @@ bool LayoutCacheKey::operator==(const LayoutCacheKey& other) const {
             && mSkewX == other.mSkewX
             && mLetterSpacing == other.mLetterSpacing
             && mPaintFlags == other.mPaintFlags
+            && mFeatureSettingsId == other.mFeatureSettingsId
             && mHyphenEdit == other.mHyphenEdit
             && mIsRtl == other.mIsRtl
             && mNchars == other.mNchars
@@ -248,9 +467,10 @@ hash_t LayoutCacheKey::computeHash() const {
     hash = JenkinsHashMix(hash, hash_type(mSkewX));
     hash = JenkinsHashMix(hash, hash_type(mLetterSpacing));
     hash = JenkinsHashMix(hash, hash_type(mPaintFlags));
+    hash = JenkinsHashMix(hash, mFeatureSettingsId);
     hash = JenkinsHashMix(hash, hash_type(mHyphenEdit.hasHyphen()));
     hash = JenkinsHashMix(hash, hash_type(mIsRtl));
-    hash = JenkinsHashMixShorts(hash, mChars, mNchars);
+    hash = JenkinsHashMix(hash, hashText(mChars, mNchars));
     return JenkinsHashWhiten(hash);
 }
 
@@ -274,9 +494,17 @@ void Layout::init() {
 }
 
 void Layout::reset() {
-    mGlyphs.clear();
+    mGlyphIds.clear();
+    mGlyphXs.clear();
+    mGlyphYs.clear();
+    mFontRuns.clear();
+    mWords.clear();
+    mRecordWords = false;
+    mWordsValid = false;
+    mWordsForcedLtr = false;
     mFaces.clear();
     mBounds.setEmpty();
+    mBoundsValid = false;
     mAdvances.clear();
     mAdvance = 0;
 }
@@ -287,9 +515,8 @@ void Layout::setFontCollection(const FontCollection* collection) {
 
 static hb_position_t harfbuzzGetGlyphHorizontalAdvance(hb_font_t* /* hbFont */, void* fontData,
         hb_codepoint_t glyph, void* /* userData */) {
-    MinikinPaint* paint = reinterpret_cast<MinikinPaint*>(fontData);
-    MinikinFont* font = paint->font;
-    float advance = font->GetHorizontalAdvance(glyph, *paint);
+    LayoutContext* ctx = reinterpret_cast<LayoutContext*>(fontData);
+    float advance = ctx->glyphMetrics.getHorizontalAdvance(glyph, ctx->paint);
     return 256 * advance + 0.5;
 }
 
@@ -301,15 +528,16 @@ static hb_bool_t harfbuzzGetGlyphHorizontalOrigin(hb_font_t* /* hbFont */, void*
     return true;
 }
 
-hb_font_funcs_t* getHbFontFuncs() {
-    static hb_font_funcs_t* hbFontFuncs = 0;
+static hb_font_funcs_t* createHbFontFuncs() {
+    hb_font_funcs_t* hbFontFuncs = hb_font_funcs_create();
+    hb_font_funcs_set_glyph_h_advance_func(hbFontFuncs, harfbuzzGetGlyphHorizontalAdvance, 0, 0);
+    hb_font_funcs_set_glyph_h_origin_func(hbFontFuncs, harfbuzzGetGlyphHorizontalOrigin, 0, 0);
+    hb_font_funcs_make_immutable(hbFontFuncs);
+    return hbFontFuncs;
+}
 
-    if (hbFontFuncs == 0) {
-        hbFontFuncs = hb_font_funcs_create();
-        hb_font_funcs_set_glyph_h_advance_func(hbFontFuncs, harfbuzzGetGlyphHorizontalAdvance, 0, 0);
-        hb_font_funcs_set_glyph_h_origin_func(hbFontFuncs, harfbuzzGetGlyphHorizontalOrigin, 0, 0);
-        hb_font_funcs_make_immutable(hbFontFuncs);
-    }
+hb_font_funcs_t* getHbFontFuncs() {
+    static hb_font_funcs_t* hbFontFuncs = createHbFontFuncs();
     return hbFontFuncs;
 }
 
@@ -324,10 +552,41 @@ static hb_position_t HBFloatToFixed(float v)
 }
 
 void Layout::dump() const {
-    for (size_t i = 0; i < mGlyphs.size(); i++) {
-        const LayoutGlyph& glyph = mGlyphs[i];
-        std::cout << glyph.glyph_id << ": " << glyph.x << ", " << glyph.y << std::endl;
+    for (size_t i = 0; i < mGlyphIds.size(); i++) {
+        std::cout << mGlyphIds[i] << ": " << mGlyphXs[i] << ", " << mGlyphYs[i] << std::endl;
+    }
+}
+
+hb_font_t* LayoutContext::getPooledHbFont(MinikinFont* font) {
+    const int32_t fontId = font->GetUniqueId();
+    for (const PooledHbFont& pooled : hbFontPool) {
+        if (pooled.font == font && pooled.fontId == fontId && pooled.size == paint.size
+                && pooled.scaleX == paint.scaleX) {
+            return pooled.hbFont;
+        }
     }
+    if (hbFontPool.size() >= kMaxPooledHbFonts) {
+        // Evict the oldest font that is not used by the word being shaped.
+        for (auto it = hbFontPool.begin(); it != hbFontPool.end(); ++it) {
+            if (std::find(hbFonts.begin(), hbFonts.end(), it->hbFont) == hbFonts.end()) {
+                destroyPooledHbFont(*it);
+                hbFontPool.erase(it);
+                break;
+            }
+        }
+    }
+    // The cached hb_font_t is shared with other threads, so set our funcs on a sub font.
+    hb_font_t* parent = getHbFont(font);
+    hb_font_t* hbFont = hb_font_create_sub_font(parent);
+    hb_font_destroy(parent);
+    hb_font_set_funcs(hbFont, getHbFontFuncs(), this, 0);
+    const double size = paint.size;
+    const double scaleX = paint.scaleX;
+    hb_font_set_ppem(hbFont, size * scaleX, size);
+    hb_font_set_scale(hbFont, HBFloatToFixed(size * scaleX), HBFloatToFixed(size));
+    PooledHbFont pooled = {font, fontId, paint.size, paint.scaleX, hbFont};
+    hbFontPool.push_back(pooled);
+    return hbFont;
 }
 
 int Layout::findFace(FakedFont face, LayoutContext* ctx) {
@@ -341,18 +600,13 @@ int Layout::findFace(FakedFont face, LayoutContext* ctx) {
     // Note: ctx == NULL means we're copying from the cache, no need to create
     // corresponding hb_font object.
     if (ctx != NULL) {
-        hb_font_t* font = getHbFontLocked(face.font);
-        hb_font_set_funcs(font, getHbFontFuncs(), &ctx->paint, 0);
-        ctx->hbFonts.push_back(font);
+        ctx->hbFonts.push_back(ctx->getPooledHbFont(face.font));
     }
     return ix;
 }
 
 static hb_script_t codePointToScript(hb_codepoint_t codepoint) {
-    static hb_unicode_funcs_t* u = 0;
-    if (!u) {
-        u = LayoutEngine::getInstance().unicodeFunctions;
-    }
+    static hb_unicode_funcs_t* u = LayoutEngine::getInstance().unicodeFunctions;
     return hb_unicode_script(u, codepoint);
 }
 
@@ -434,6 +688,51 @@ static bool isScriptOkForLetterspacing(hb_script_t script) {
             );
 }
 
+// BMP characters that are strong right to left letters, Arabic numbers or explicit directional
+// formatting characters.
+static bool isRtlBmpCharacter(uint32_t c) {
+    return (c >= 0x0590 && c <= 0x08FF)  // Hebrew, Arabic, Syriac, Thaana, NKo, ...
+            || c == 0x200F || (c >= 0x202A && c <= 0x202E) || (c >= 0x2066 && c <= 0x2069)
+            || (c >= 0xFB1D && c <= 0xFDFF) || (c >= 0xFE70 && c <= 0xFEFF);
+}
+
+// Conservatively returns true if the text may contain characters that make the bidi algorithm
+// produce more than one left to right run: strong right to left letters, Arabic numbers and
+// explicit directional formatting characters. Right to left characters outside the BMP are
+// recognized by their lead surrogate, so a range that starts with a trail surrogate must include
+// the unit before it.
+static bool mayHaveRtl(const uint16_t* text, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        const uint16_t c = text[i];
+        if (c < 0x0590) {
+            continue;
+        }
+        if (isRtlBmpCharacter(c)
+                // Lead surrogates of U+10800..U+10FFF and U+1E800..U+1EFFF
+                || c == 0xD802 || c == 0xD803 || c == 0xD83A || c == 0xD83B) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// The same for UTF-8 text.
+static bool mayHaveRtlUtf8(const uint8_t* text, size_t length) {
+    size_t i = 0;
+    while (i < length) {
+        if (text[i] < 0x80) {
+            i++;
+            continue;
+        }
+        const uint32_t c = nextUtf8CodePoint(text, &i, length);
+        if (isRtlBmpCharacter(c) || (c >= 0x10800 && c <= 0x10FFF)
+                || (c >= 0x1E800 && c <= 0x1EFFF)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 class BidiText {
 public:
     class Iter {
@@ -444,11 +743,12 @@ public:
             bool mIsRtl;
         };
 
-        Iter(UBiDi* bidi, size_t start, size_t end, size_t runIndex, size_t runCount, bool isRtl);
+        Iter(UBiDi* bidi, const BidiParagraph* paragraph, size_t start, size_t end,
+                size_t runIndex, size_t runCount, bool isRtl);
 
         bool operator!= (const Iter& other) const {
             return mIsEnd != other.mIsEnd || mNextRunIndex != other.mNextRunIndex
-                    || mBidi != other.mBidi;
+                    || mBidi != other.mBidi || mParagraph != other.mParagraph;
         }
 
         const RunInfo& operator* () const {
@@ -462,6 +762,7 @@ public:
 
     private:
         UBiDi* const mBidi;
+        const BidiParagraph* const mParagraph;
         bool mIsEnd;
         size_t mNextRunIndex;
         const size_t mRunCount;
@@ -472,20 +773,17 @@ public:
         void updateRunInfo();
     };
 
-    BidiText(const uint16_t* buf, size_t start, size_t count, size_t bufSize, int bidiFlags);
-
-    ~BidiText() {
-        if (mBidi) {
-            ubidi_close(mBidi);
-        }
-    }
+    // The UBiDi object of ctx is used if the text needs bidi analysis. If paragraph is not null,
+    // its runs are used instead, and buf, bufSize and bidiFlags must be those of the paragraph.
+    BidiText(const uint16_t* buf, size_t start, size_t count, size_t bufSize, int bidiFlags,
+            LayoutContext* ctx, const BidiParagraph* paragraph = nullptr);
 
     Iter begin () const {
-        return Iter(mBidi, mStart, mEnd, 0, mRunCount, mIsRtl);
+        return Iter(mBidi, mParagraph, mStart, mEnd, 0, mRunCount, mIsRtl);
     }
 
     Iter end() const {
-        return Iter(mBidi, mStart, mEnd, mRunCount, mRunCount, mIsRtl);
+        return Iter(mBidi, mParagraph, mStart, mEnd, mRunCount, mRunCount, mIsRtl);
     }
 
 private:
@@ -493,6 +791,7 @@ private:
     const size_t mEnd;
     const size_t mBufSize;
     UBiDi* mBidi;
+    const BidiParagraph* mParagraph;
     size_t mRunCount;
     bool mIsRtl;
 
@@ -500,10 +799,10 @@ private:
     void operator=(const BidiText&) = delete;
 };
 
-BidiText::Iter::Iter(UBiDi* bidi, size_t start, size_t end, size_t runIndex, size_t runCount,
-        bool isRtl)
-    : mBidi(bidi), mIsEnd(runIndex == runCount), mNextRunIndex(runIndex), mRunCount(runCount),
-      mStart(start), mEnd(end), mRunInfo() {
+BidiText::Iter::Iter(UBiDi* bidi, const BidiParagraph* paragraph, size_t start, size_t end,
+        size_t runIndex, size_t runCount, bool isRtl)
+    : mBidi(bidi), mParagraph(paragraph), mIsEnd(runIndex == runCount), mNextRunIndex(runIndex),
+      mRunCount(runCount), mStart(start), mEnd(end), mRunInfo() {
     if (mRunCount == 1) {
         mRunInfo.mRunStart = start;
         mRunInfo.mRunLength = end - start;
@@ -522,7 +821,14 @@ void BidiText::Iter::updateRunInfo() {
     }
     int32_t startRun = -1;
     int32_t lengthRun = -1;
-    const UBiDiDirection runDir = ubidi_getVisualRun(mBidi, mNextRunIndex, &startRun, &lengthRun);
+    bool isRtl;
+    if (mParagraph != nullptr) {
+        startRun = mParagraph->getRunStart(mNextRunIndex);
+        lengthRun = mParagraph->getRunLength(mNextRunIndex);
+        isRtl = mParagraph->isRunRtl(mNextRunIndex);
+    } else {
+        isRtl = ubidi_getVisualRun(mBidi, mNextRunIndex, &startRun, &lengthRun) == UBIDI_RTL;
+    }
     mNextRunIndex++;
     if (startRun == -1 || lengthRun == -1) {
         ALOGE("invalid visual run");
@@ -538,19 +844,46 @@ void BidiText::Iter::updateRunInfo() {
         updateRunInfo();
         return;
     }
-    mRunInfo.mIsRtl = (runDir == UBIDI_RTL);
+    mRunInfo.mIsRtl = isRtl;
+}
+
+void BidiParagraph::setParagraph(const uint16_t* buf, size_t bufSize, int bidiFlags) {
+    mBuf = buf;
+    mBufSize = bufSize;
+    mBidiFlags = bidiFlags;
+    mRuns.clear();
+    ScopedLayoutContext ctx;
+    for (const BidiText::Iter::RunInfo& runInfo :
+            BidiText(buf, 0, bufSize, bufSize, bidiFlags, ctx.get())) {
+        Run run = {static_cast<uint32_t>(runInfo.mRunStart),
+                static_cast<uint32_t>(runInfo.mRunLength), runInfo.mIsRtl};
+        mRuns.push_back(run);
+    }
 }
 
-BidiText::BidiText(const uint16_t* buf, size_t start, size_t count, size_t bufSize, int bidiFlags)
-    : mStart(start), mEnd(start + count), mBufSize(bufSize), mBidi(NULL), mRunCount(1),
-      mIsRtl((bidiFlags & kDirection_Mask) != 0) {
+BidiText::BidiText(const uint16_t* buf, size_t start, size_t count, size_t bufSize, int bidiFlags,
+        LayoutContext* ctx, const BidiParagraph* paragraph)
+    : mStart(start), mEnd(start + count), mBufSize(bufSize), mBidi(NULL), mParagraph(NULL),
+      mRunCount(1), mIsRtl((bidiFlags & kDirection_Mask) != 0) {
+    if (paragraph != NULL) {
+        if (paragraph->nRuns() == 1) {
+            mIsRtl = paragraph->isRunRtl(0);
+        } else if (paragraph->nRuns() > 1) {
+            mParagraph = paragraph;
+            mRunCount = paragraph->nRuns();
+        }
+        return;
+    }
     if (bidiFlags == kBidi_Force_LTR || bidiFlags == kBidi_Force_RTL) {
         // force single run.
         return;
     }
-    mBidi = ubidi_open();
+    if ((bidiFlags == kBidi_LTR || bidiFlags == kBidi_Default_LTR) && !mayHaveRtl(buf, bufSize)) {
+        // Without right to left characters, a left to right paragraph is a single run.
+        return;
+    }
+    mBidi = ctx->getBidi();
     if (!mBidi) {
-        ALOGE("error creating bidi object");
         return;
     }
     UErrorCode status = U_ZERO_ERROR;
@@ -577,49 +910,13 @@ BidiText::BidiText(const uint16_t* buf, size_t start, size_t count, size_t bufSi
     mRunCount = rc;
 }
 
-void Layout::doLayout(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
-        int bidiFlags, const FontStyle &style, const MinikinPaint &paint) {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
-
-    LayoutContext ctx;
-    ctx.style = style;
-    ctx.paint = paint;
-
-    reset();
-    mAdvances.resize(count, 0);
-
-    for (const BidiText::Iter::RunInfo& runInfo : BidiText(buf, start, count, bufSize, bidiFlags)) {
-        doLayoutRunCached(buf, runInfo.mRunStart, runInfo.mRunLength, bufSize, runInfo.mIsRtl, &ctx,
-                start, mCollection, this, NULL);
-    }
-    ctx.clearHbFonts();
-}
-
-float Layout::measureText(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
-        int bidiFlags, const FontStyle &style, const MinikinPaint &paint,
-        const FontCollection* collection, float* advances) {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
-
-    LayoutContext ctx;
-    ctx.style = style;
-    ctx.paint = paint;
-
-    float advance = 0;
-    for (const BidiText::Iter::RunInfo& runInfo : BidiText(buf, start, count, bufSize, bidiFlags)) {
-        float* advancesForRun = advances ? advances + (runInfo.mRunStart - start) : advances;
-        advance += doLayoutRunCached(buf, runInfo.mRunStart, runInfo.mRunLength, bufSize,
-                runInfo.mIsRtl, &ctx, 0, collection, NULL, advancesForRun);
-    }
-
-    ctx.clearHbFonts();
-    return advance;
-}
-
-float Layout::doLayoutRunCached(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
-        bool isRtl, LayoutContext* ctx, size_t dstStart, const FontCollection* collection,
-        Layout* layout, float* advances) {
+// Calls f for each cache word of a bidi run, in visual order, with ctx->paint.hyphenEdit set up
+// for that word. f gets the word's context (wordBuf, wordBufSize), the offset and length of the
+// part of the word inside the run, and the position of that part in buf.
+template <typename F>
+static void forEachCacheWord(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        bool isRtl, LayoutContext* ctx, F& f) {
     HyphenEdit hyphen = ctx->paint.hyphenEdit;
-    float advance = 0;
     if (!isRtl) {
         // left to right
         size_t wordstart =
@@ -630,9 +927,7 @@ float Layout::doLayoutRunCached(const uint16_t* buf, size_t start, size_t count,
             // Only apply hyphen to the last word in the string.
             ctx->paint.hyphenEdit = wordend >= start + count ? hyphen : HyphenEdit();
             size_t wordcount = std::min(start + count, wordend) - iter;
-            advance += doLayoutWord(buf + wordstart, iter - wordstart, wordcount,
-                    wordend - wordstart, isRtl, ctx, iter - dstStart, collection, layout,
-                    advances ? advances + (iter - start) : advances);
+            f(buf + wordstart, iter - wordstart, wordcount, wordend - wordstart, iter);
             wordstart = wordend;
         }
     } else {
@@ -645,74 +940,464 @@ float Layout::doLayoutRunCached(const uint16_t* buf, size_t start, size_t count,
             // Only apply hyphen to the last (leftmost) word in the string.
             ctx->paint.hyphenEdit = iter == end ? hyphen : HyphenEdit();
             size_t bufStart = std::max(start, wordstart);
-            advance += doLayoutWord(buf + wordstart, bufStart - wordstart, iter - bufStart,
-                    wordend - wordstart, isRtl, ctx, bufStart - dstStart, collection, layout,
-                    advances ? advances + (bufStart - start) : advances);
+            f(buf + wordstart, bufStart - wordstart, iter - bufStart, wordend - wordstart,
+                    bufStart);
             wordend = wordstart;
         }
     }
-    return advance;
 }
 
-float Layout::doLayoutWord(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
-        bool isRtl, LayoutContext* ctx, size_t bufStart, const FontCollection* collection,
-        Layout* layout, float* advances) {
-    LayoutCache& cache = LayoutEngine::getInstance().layoutCache;
-    LayoutCacheKey key(collection, ctx->paint, ctx->style, buf, start, count, bufSize, isRtl);
-    bool skipCache = ctx->paint.skipCache();
-    if (skipCache) {
-        Layout layoutForWord;
-        key.doLayout(&layoutForWord, ctx, collection);
-        if (layout) {
-            layout->appendLayout(&layoutForWord, bufStart);
-        }
-        if (advances) {
-            layoutForWord.getAdvances(advances);
-        }
-        return layoutForWord.getAdvance();
+// Returns a new reference to the shaped word, from the layout cache if possible.
+static LayoutPiece* getLayoutPiece(const uint16_t* buf, size_t start, size_t count,
+        size_t bufSize, bool isRtl, LayoutContext* ctx, const FontCollection* collection) {
+    LayoutCacheKey key(collection, ctx->paint, ctx->style, ctx->featureSettingsId, buf, start,
+            count, bufSize, isRtl);
+    if (ctx->featureSettingsId == FontFeatureSettingsCache::kUncachedSettingsId) {
+        return key.createPiece(ctx, collection);
+    }
+    return LayoutEngine::getInstance().layoutCache.getOrCreate(key, ctx, collection);
+}
+
+// A cache word to be shaped on a worker thread by the parallel layout path.
+struct LayoutWordTask {
+    const uint16_t* buf;
+    size_t start;
+    size_t count;
+    size_t bufSize;
+    bool isRtl;
+    HyphenEdit hyphenEdit;
+    size_t dstStart;
+    LayoutPiece* piece;
+};
+
+// Paragraphs shorter than this are always laid out on the calling thread.
+static const size_t kMinParallelLayoutLength = 2048;
+// Number of words or measurement items handed to a thread at once.
+static const size_t kParallelChunkSize = 32;
+
+void Layout::doLayout(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint) {
+    ScopedLayoutContext ctx(style, paint);
+    doLayoutWithContext(buf, start, count, bufSize, bidiFlags, ctx.get());
+}
+
+void Layout::doLayout(const BidiParagraph& paragraph, size_t start, size_t count,
+        const FontStyle &style, const MinikinPaint &paint) {
+    ScopedLayoutContext ctx(style, paint);
+    doLayoutWithContext(paragraph.getText(), start, count, paragraph.getTextSize(),
+            paragraph.getBidiFlags(), ctx.get(), &paragraph);
+}
+
+bool Layout::doLayout(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint,
+        GlyphOutputBuffers* output) {
+    output->glyphCount = 0;
+    mOutput = output;
+    ScopedLayoutContext ctx(style, paint);
+    doLayoutWithContext(buf, start, count, bufSize, bidiFlags, ctx.get());
+    mOutput = nullptr;
+
+    output->faceCount = mFaces.size();
+    std::copy(mFaces.begin(), mFaces.begin() + std::min(mFaces.size(), output->faceCapacity),
+            output->faces);
+    return output->glyphCount <= output->glyphCapacity
+            && output->faceCount <= output->faceCapacity;
+}
+
+// Converts the part of buf that the layout of [start, start + count) depends on into text and
+// returns the byte offset it starts at. That is the words around the range, unless the bidi
+// algorithm needs the whole paragraph to find the runs.
+static size_t transcodeUtf8Context(const uint8_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, Utf8Transcoder* text) {
+    size_t contextStart = 0;
+    size_t contextEnd = bufSize;
+    if (bidiFlags == kBidi_Force_LTR || bidiFlags == kBidi_Force_RTL
+            || ((bidiFlags == kBidi_LTR || bidiFlags == kBidi_Default_LTR)
+                    && !mayHaveRtlUtf8(buf, bufSize))) {
+        contextStart = getPrevWordStartUtf8(buf, start, bufSize);
+        contextEnd = getNextWordStartUtf8(buf, start + count, bufSize);
+    }
+    text->transcode(buf + contextStart, contextEnd - contextStart);
+    return contextStart;
+}
+
+void Layout::doLayoutUtf8(const uint8_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint) {
+    ScopedLayoutContext scopedCtx(style, paint);
+    LayoutContext* ctx = scopedCtx.get();
+    Utf8Transcoder& text = ctx->utf8Transcoder;
+    const size_t contextStart = transcodeUtf8Context(buf, start, count, bufSize, bidiFlags, &text);
+    const size_t utf16Start = text.utf8ToUtf16[start - contextStart];
+    const size_t utf16Count = text.utf8ToUtf16[start + count - contextStart] - utf16Start;
+    doLayoutWithContext(text.utf16.data(), utf16Start, utf16Count, text.utf16.size(), bidiFlags,
+            ctx);
+    // The recorded words are in UTF-16 units of the converted part, which doLayoutAfterEdit
+    // cannot use.
+    mWordsValid = false;
+
+    // Report advances per byte.
+    ctx->utf16Advances.swap(mAdvances);
+    mAdvances.resize(count);
+    text.toUtf8Advances(ctx->utf16Advances.data(), utf16Start, utf16Count, mAdvances.data(),
+            start - contextStart, count);
+}
+
+void Layout::doLayoutWithContext(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, LayoutContext* ctx, const BidiParagraph* paragraph) {
+    reset();
+    mAdvances.resize(count, 0);
+    mPaint = ctx->paint;
+    // Whole paragraphs laid out as a single left to right run can be updated by
+    // doLayoutAfterEdit. The hyphen edit only applies to the last word, so leave those out.
+    const bool canEditLater = start == 0 && count == bufSize && mOutput == nullptr
+            && !ctx->paint.hyphenEdit.hasHyphen();
+    mRecordWords = canEditLater;
+    size_t runCount = 0;
+    bool hasRtlRun = false;
+
+    std::shared_ptr<ThreadPool> pool;
+    if (count >= kMinParallelLayoutLength) {
+        pool = LayoutEngine::getInstance().getThreadPool();
+    }
+    if (!pool) {
+        for (const BidiText::Iter::RunInfo& runInfo :
+                BidiText(buf, start, count, bufSize, bidiFlags, ctx, paragraph)) {
+            doLayoutRunCached(buf, runInfo.mRunStart, runInfo.mRunLength, bufSize,
+                    runInfo.mIsRtl, ctx, start, mCollection, this, NULL);
+            runCount++;
+            hasRtlRun |= runInfo.mIsRtl;
+        }
+        mWordsValid = canEditLater && runCount <= 1 && !hasRtlRun;
+        mWordsForcedLtr = bidiFlags == kBidi_Force_LTR;
+        return;
+    }
+
+    // Split the paragraph into words exactly like the serial path, shape them on the pool, then
+    // append them in visual order so that the result is identical.
+    std::vector<LayoutWordTask, ScratchAllocator<LayoutWordTask>> tasks(
+            (ScratchAllocator<LayoutWordTask>(&ctx->arena)));
+    for (const BidiText::Iter::RunInfo& runInfo :
+            BidiText(buf, start, count, bufSize, bidiFlags, ctx, paragraph)) {
+        const bool isRtl = runInfo.mIsRtl;
+        runCount++;
+        hasRtlRun |= isRtl;
+        auto addTask = [&](const uint16_t* wordBuf, size_t wordStart, size_t wordCount,
+                size_t wordBufSize, size_t bufPos) {
+            LayoutWordTask task = {wordBuf, wordStart, wordCount, wordBufSize, isRtl,
+                    ctx->paint.hyphenEdit, bufPos - start, nullptr};
+            tasks.push_back(task);
+        };
+        forEachCacheWord(buf, runInfo.mRunStart, runInfo.mRunLength, bufSize, isRtl, ctx,
+                addTask);
+    }
+
+    if (mRecordWords) {
+        mWords.reserve(tasks.size());
+    }
+
+    // Shaping writes ctx->paint, so chunks must not copy it while the calling thread works.
+    const LayoutContextSnapshot snapshot(*ctx);
+    const std::thread::id callerId = std::this_thread::get_id();
+    const size_t chunkCount = (tasks.size() + kParallelChunkSize - 1) / kParallelChunkSize;
+    auto shapeChunk = [&](size_t chunk, LayoutContext* taskCtx) {
+        const size_t end = std::min(tasks.size(), (chunk + 1) * kParallelChunkSize);
+        for (size_t i = chunk * kParallelChunkSize; i < end; i++) {
+            LayoutWordTask& task = tasks[i];
+            taskCtx->paint.hyphenEdit = task.hyphenEdit;
+            task.piece = getLayoutPiece(task.buf, task.start, task.count, task.bufSize,
+                    task.isRtl, taskCtx, mCollection);
+        }
+    };
+    pool->parallelFor(chunkCount, [&](size_t chunk) {
+        // The calling thread already owns its context; workers borrow their own.
+        if (std::this_thread::get_id() == callerId) {
+            snapshot.applyTo(ctx);
+            shapeChunk(chunk, ctx);
+        } else {
+            ScopedLayoutContext workerCtx(snapshot);
+            shapeChunk(chunk, workerCtx.get());
+        }
+    });
+
+    for (const LayoutWordTask& task : tasks) {
+        appendLayout(task.piece, task.dstStart, ctx);
+        task.piece->unref();
+    }
+    mWordsValid = canEditLater && runCount <= 1 && !hasRtlRun;
+    mWordsForcedLtr = bidiFlags == kBidi_Force_LTR;
+}
+
+void Layout::doLayoutAfterEdit(const Layout& prev, size_t editStart, size_t oldLength,
+        size_t newLength, const uint16_t* buf, size_t bufSize, int bidiFlags,
+        const FontStyle &style, const MinikinPaint &paint) {
+    ScopedLayoutContext scopedCtx(style, paint);
+    LayoutContext* ctx = scopedCtx.get();
+
+    const size_t prevSize = bufSize + oldLength - newLength;
+    bool bidiOk;
+    if (bidiFlags == kBidi_Force_LTR) {
+        bidiOk = true;
+    } else if (bidiFlags == kBidi_LTR || bidiFlags == kBidi_Default_LTR) {
+        // prev was a single left to right run, so the new text is one as well unless the
+        // inserted characters change that. The units on both sides of the edit are checked
+        // too, since the edit may complete a surrogate pair with them.
+        const size_t checkEnd = std::min(editStart + newLength + 1, bufSize);
+        const size_t checkStart = std::min(editStart > 0 ? editStart - 1 : 0, checkEnd);
+        bidiOk = !prev.mWordsForcedLtr
+                && !mayHaveRtl(buf + checkStart, checkEnd - checkStart);
     } else {
-        Layout* layoutForWord = cache.get(key, ctx, collection);
-        if (layout) {
-            layout->appendLayout(layoutForWord, bufStart);
+        bidiOk = false;
+    }
+    if (!bidiOk || !prev.mWordsValid || prev.mCollection != mCollection
+            || paint.hyphenEdit.hasHyphen() || prev.mAdvances.size() != prevSize
+            || editStart + newLength > bufSize) {
+        doLayoutWithContext(buf, 0, bufSize, bufSize, bidiFlags, ctx);
+        return;
+    }
+
+    // Whether there is a cache word break at a position only depends on the characters on both
+    // sides of it, so the breaks before editStart and after the inserted text are the same as in
+    // the previous text. Everything between the last break before the edit and the first break
+    // after it is shaped again; the words outside are copied from prev.
+    const size_t affectedStart = getPrevWordBreakForCache(buf, editStart, bufSize);
+    const size_t affectedEnd = getNextWordBreakForCache(buf, editStart + newLength, bufSize);
+    const size_t prevAffectedEnd = affectedEnd + oldLength - newLength;
+    auto findWord = [&prev](size_t charStart) {
+        auto it = std::lower_bound(prev.mWords.begin(), prev.mWords.end(), charStart,
+                [](const WordInfo& word, size_t pos) { return word.charStart < pos; });
+        return it - prev.mWords.begin();
+    };
+    const size_t prefixWords = findWord(affectedStart);
+    const size_t suffixWord = findWord(prevAffectedEnd);
+    if ((prefixWords < prev.mWords.size() && prev.mWords[prefixWords].charStart != affectedStart)
+            || (suffixWord < prev.mWords.size()
+                    && prev.mWords[suffixWord].charStart != prevAffectedEnd)
+            || (suffixWord == prev.mWords.size() && prevAffectedEnd != prevSize)) {
+        // The word table does not match the text; prev was probably made from other text.
+        doLayoutWithContext(buf, 0, bufSize, bufSize, bidiFlags, ctx);
+        return;
+    }
+
+    // Laying out in place: keep the previous result around while building the new one.
+    Layout prevCopy;
+    const Layout* src = &prev;
+    if (src == this) {
+        prevCopy = std::move(*this);
+        src = &prevCopy;
+    }
+    reset();
+    mAdvances.resize(bufSize, 0);
+    mPaint = ctx->paint;
+    mFaces = src->mFaces;
+    mRecordWords = true;
+    mWords.reserve(src->mWords.size() + affectedEnd - affectedStart);
+
+    // Words before the edit are copied as they are.
+    const size_t prefixGlyphs = prefixWords < src->mWords.size()
+            ? src->mWords[prefixWords].glyphStart : src->mGlyphIds.size();
+    mGlyphIds.assign(src->mGlyphIds.begin(), src->mGlyphIds.begin() + prefixGlyphs);
+    mGlyphXs.assign(src->mGlyphXs.begin(), src->mGlyphXs.begin() + prefixGlyphs);
+    mGlyphYs.assign(src->mGlyphYs.begin(), src->mGlyphYs.begin() + prefixGlyphs);
+    for (const FontRun& run : src->mFontRuns) {
+        if (run.start >= prefixGlyphs) {
+            break;
         }
-        if (advances) {
-            layoutForWord->getAdvances(advances);
+        mFontRuns.push_back(run);
+    }
+    mWords.assign(src->mWords.begin(), src->mWords.begin() + prefixWords);
+    std::copy(src->mAdvances.begin(), src->mAdvances.begin() + affectedStart, mAdvances.begin());
+    mAdvance = prefixWords < src->mWords.size() ? src->mWords[prefixWords].x : src->mAdvance;
+
+    // Words touched by the edit are shaped again, through the layout cache.
+    doLayoutRunCached(buf, affectedStart, affectedEnd - affectedStart, bufSize, false, ctx, 0,
+            mCollection, this, NULL);
+
+    // Words after the edit move by the change in advance. Glyphs are positioned relative to the
+    // truncated pen position of their word, so shift them word by word exactly like
+    // appendLayout does.
+    const size_t charDelta = bufSize - prevSize;
+    size_t run = 0;
+    for (size_t w = suffixWord; w < src->mWords.size(); w++) {
+        const WordInfo& word = src->mWords[w];
+        const size_t glyphEnd = w + 1 < src->mWords.size()
+                ? src->mWords[w + 1].glyphStart : src->mGlyphIds.size();
+        const size_t n = glyphEnd - word.glyphStart;
+        const size_t dst = mGlyphIds.size();
+        const int x0 = mAdvance;
+        const int prevX0 = word.x;
+        WordInfo newWord = {static_cast<uint32_t>(word.charStart + charDelta),
+                static_cast<uint32_t>(dst), mAdvance, word.advance};
+        mWords.push_back(newWord);
+        if (n > 0) {
+            mGlyphIds.insert(mGlyphIds.end(), src->mGlyphIds.begin() + word.glyphStart,
+                    src->mGlyphIds.begin() + glyphEnd);
+            mGlyphXs.resize(dst + n);
+            offsetPositions(&mGlyphXs[dst], &src->mGlyphXs[word.glyphStart], x0 - prevX0, n);
+            mGlyphYs.insert(mGlyphYs.end(), src->mGlyphYs.begin() + word.glyphStart,
+                    src->mGlyphYs.begin() + glyphEnd);
+            while (run + 1 < src->mFontRuns.size()
+                    && src->mFontRuns[run + 1].start <= word.glyphStart) {
+                run++;
+            }
+            for (size_t r = run; r < src->mFontRuns.size() && src->mFontRuns[r].start < glyphEnd;
+                    r++) {
+                const size_t runStart = std::max<size_t>(src->mFontRuns[r].start,
+                        word.glyphStart);
+                appendFontRun(dst + runStart - word.glyphStart, src->mFontRuns[r].faceIx);
+            }
         }
-        return layoutForWord->getAdvance();
+        mAdvance += word.advance;
+    }
+    std::copy(src->mAdvances.begin() + prevAffectedEnd, src->mAdvances.end(),
+            mAdvances.begin() + affectedEnd);
+    // Faces were looked up in the order of prev; the reshaped words may add or stop using some.
+    renumberFaces();
+    mWordsValid = true;
+    mWordsForcedLtr = bidiFlags == kBidi_Force_LTR;
+}
+
+void Layout::renumberFaces() {
+    std::vector<int> faceMap(mFaces.size(), -1);
+    std::vector<FakedFont> faces;
+    for (FontRun& run : mFontRuns) {
+        int& faceIx = faceMap[run.faceIx];
+        if (faceIx < 0) {
+            faceIx = faces.size();
+            faces.push_back(mFaces[run.faceIx]);
+        }
+        run.faceIx = faceIx;
+    }
+    mFaces.swap(faces);
+}
+
+float Layout::measureText(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint,
+        const FontCollection* collection, float* advances) {
+    ScopedLayoutContext ctx(style, paint);
+    return measureTextWithContext(buf, start, count, bufSize, bidiFlags, ctx.get(), collection,
+            advances);
+}
+
+float Layout::measureText(const BidiParagraph& paragraph, size_t start, size_t count,
+        const FontStyle &style, const MinikinPaint &paint, const FontCollection* collection,
+        float* advances) {
+    ScopedLayoutContext ctx(style, paint);
+    return measureTextWithContext(paragraph.getText(), start, count, paragraph.getTextSize(),
+            paragraph.getBidiFlags(), ctx.get(), collection, advances, &paragraph);
+}
+
+float Layout::measureTextUtf8(const uint8_t* buf, size_t start, size_t count, size_t bufSize,
+        int bidiFlags, const FontStyle &style, const MinikinPaint &paint,
+        const FontCollection* collection, float* advances) {
+    ScopedLayoutContext scopedCtx(style, paint);
+    LayoutContext* ctx = scopedCtx.get();
+    Utf8Transcoder& text = ctx->utf8Transcoder;
+    const size_t contextStart = transcodeUtf8Context(buf, start, count, bufSize, bidiFlags, &text);
+    const size_t utf16Start = text.utf8ToUtf16[start - contextStart];
+    const size_t utf16Count = text.utf8ToUtf16[start + count - contextStart] - utf16Start;
+    float* utf16Advances = nullptr;
+    if (advances) {
+        ctx->utf16Advances.resize(utf16Count);
+        utf16Advances = ctx->utf16Advances.data();
+    }
+    const float advance = measureTextWithContext(text.utf16.data(), utf16Start, utf16Count,
+            text.utf16.size(), bidiFlags, ctx, collection, utf16Advances);
+    if (advances) {
+        text.toUtf8Advances(utf16Advances, utf16Start, utf16Count, advances, start - contextStart,
+                count);
     }
+    return advance;
 }
 
-static void addFeatures(const string &str, vector<hb_feature_t>* features) {
-    if (!str.size())
+void Layout::measureTextBatch(MeasureTextItem* items, size_t itemCount) {
+    auto measureItems = [](MeasureTextItem* batch, size_t batchCount) {
+        ScopedLayoutContext scopedCtx;
+        LayoutContext* ctx = scopedCtx.get();
+        for (size_t i = 0; i < batchCount; i++) {
+            MeasureTextItem& item = batch[i];
+            // Labels in a batch usually share the paint, so only intern the feature settings
+            // again when they change.
+            if (i == 0 || item.paint->fontFeatureSettings != ctx->paint.fontFeatureSettings) {
+                ctx->featureSettingsId =
+                        FontFeatureSettingsCache::getId(item.paint->fontFeatureSettings);
+            }
+            ctx->style = *item.style;
+            ctx->paint = *item.paint;
+            item.totalAdvance = measureTextWithContext(item.buf, item.start, item.count,
+                    item.bufSize, item.bidiFlags, ctx, item.collection, item.advances);
+        }
+    };
+
+    std::shared_ptr<ThreadPool> pool;
+    if (itemCount > kParallelChunkSize) {
+        pool = LayoutEngine::getInstance().getThreadPool();
+    }
+    if (!pool) {
+        measureItems(items, itemCount);
         return;
+    }
+    // The items are independent, so each thread measures whole chunks of them.
+    const size_t chunkCount = (itemCount + kParallelChunkSize - 1) / kParallelChunkSize;
+    pool->parallelFor(chunkCount, [&](size_t chunk) {
+        const size_t chunkStart = chunk * kParallelChunkSize;
+        measureItems(items + chunkStart, std::min(kParallelChunkSize, itemCount - chunkStart));
+    });
+}
 
-    const char* start = str.c_str();
-    const char* end = start + str.size();
+float Layout::measureTextWithContext(const uint16_t* buf, size_t start, size_t count,
+        size_t bufSize, int bidiFlags, LayoutContext* ctx, const FontCollection* collection,
+        float* advances, const BidiParagraph* paragraph) {
+    float advance = 0;
+    for (const BidiText::Iter::RunInfo& runInfo :
+            BidiText(buf, start, count, bufSize, bidiFlags, ctx, paragraph)) {
+        float* advancesForRun = advances ? advances + (runInfo.mRunStart - start) : advances;
+        advance += doLayoutRunCached(buf, runInfo.mRunStart, runInfo.mRunLength, bufSize,
+                runInfo.mIsRtl, ctx, 0, collection, NULL, advancesForRun);
+    }
+    return advance;
+}
+
+float Layout::doLayoutRunCached(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        bool isRtl, LayoutContext* ctx, size_t dstStart, const FontCollection* collection,
+        Layout* layout, float* advances) {
+    float advance = 0;
+    auto layoutWord = [&](const uint16_t* wordBuf, size_t wordStart, size_t wordCount,
+            size_t wordBufSize, size_t bufPos) {
+        advance += doLayoutWord(wordBuf, wordStart, wordCount, wordBufSize, isRtl, ctx,
+                bufPos - dstStart, collection, layout,
+                advances ? advances + (bufPos - start) : advances);
+    };
+    forEachCacheWord(buf, start, count, bufSize, isRtl, ctx, layoutWord);
+    return advance;
+}
 
-    while (start < end) {
-        static hb_feature_t feature;
-        const char* p = strchr(start, ',');
-        if (!p)
-            p = end;
-        /* We do not allow setting features on ranges.  As such, reject any
-         * setting that has non-universal range. */
-        if (hb_feature_from_string (start, p - start, &feature)
-                && feature.start == 0 && feature.end == (unsigned int) -1)
-            features->push_back(feature);
-        start = p + 1;
+float Layout::doLayoutWord(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
+        bool isRtl, LayoutContext* ctx, size_t bufStart, const FontCollection* collection,
+        Layout* layout, float* advances) {
+    LayoutPiece* piece = getLayoutPiece(buf, start, count, bufSize, isRtl, ctx, collection);
+    if (layout) {
+        layout->appendLayout(piece, bufStart, ctx);
     }
+    if (advances) {
+        memcpy(advances, piece->getAdvances(), piece->nAdvances() * sizeof(float));
+    }
+    float advance = piece->getAdvance();
+    piece->unref();
+    return advance;
 }
 
 void Layout::doLayoutRun(const uint16_t* buf, size_t start, size_t count, size_t bufSize,
         bool isRtl, LayoutContext* ctx) {
-    hb_buffer_t* buffer = LayoutEngine::getInstance().hbBuffer;
-    vector<FontCollection::Run> items;
-    mCollection->itemize(buf + start, count, ctx->style, &items);
+    hb_buffer_t* buffer = ctx->buffer;
+    vector<FontCollection::Run>& items = ctx->items;
+    items.clear();
+    itemizeCached(mCollection, buf + start, count, ctx->style, &items);
     if (isRtl) {
         std::reverse(items.begin(), items.end());
     }
 
-    vector<hb_feature_t> features;
+    vector<hb_feature_t>& features = ctx->features;
+    features.clear();
     // Disable default-on non-required ligature features if letter-spacing
     // See http://dev.w3.org/csswg/css-text-3/#letter-spacing-property
     // "When the effective spacing between two characters is not zero (due to
@@ -725,7 +1410,13 @@ void Layout::doLayoutRun(const uint16_t* buf, size_t start, size_t count, size_t
         features.push_back(no_liga);
         features.push_back(no_clig);
     }
-    addFeatures(ctx->paint.fontFeatureSettings, &features);
+    if (ctx->featureSettingsId == FontFeatureSettingsCache::kUncachedSettingsId) {
+        FontFeatureSettingsCache::parse(ctx->paint.fontFeatureSettings, &features);
+    } else {
+        const FontFeatureSettings& featureSettings =
+                FontFeatureSettingsCache::getById(ctx->featureSettingsId);
+        features.insert(features.end(), featureSettings.begin(), featureSettings.end());
+    }
 
     double size = ctx->paint.size;
     double scaleX = ctx->paint.scaleX;
@@ -746,9 +1437,6 @@ void Layout::doLayoutRun(const uint16_t* buf, size_t start, size_t count, size_t
         ALOGD("Run %zu, font %d [%d:%d]", run_ix, font_ix, run.start, run.end);
 #endif
 
-        hb_font_set_ppem(hbFont, size * scaleX, size);
-        hb_font_set_scale(hbFont, HBFloatToFixed(size * scaleX), HBFloatToFixed(size));
-
         // TODO: if there are multiple scripts within a font in an RTL run,
         // we need to reorder those runs. This is unlikely with our current
         // font stack, but should be done for correctness.
@@ -833,16 +1521,11 @@ void Layout::doLayoutRun(const uint16_t* buf, size_t start, size_t count, size_t
                 float xoff = HBFixedToFloat(positions[i].x_offset);
                 float yoff = -HBFixedToFloat(positions[i].y_offset);
                 xoff += yoff * ctx->paint.skewX;
-                LayoutGlyph glyph = {font_ix, glyph_ix, x + xoff, y + yoff};
-                mGlyphs.push_back(glyph);
+                appendGlyph(font_ix, glyph_ix, x + xoff, y + yoff);
                 float xAdvance = HBFixedToFloat(positions[i].x_advance);
                 if ((ctx->paint.paintFlags & LinearTextFlag) == 0) {
                     xAdvance = roundf(xAdvance);
                 }
-                MinikinRect glyphBounds;
-                ctx->paint.font->GetBounds(&glyphBounds, glyph_ix, ctx->paint);
-                glyphBounds.offset(x + xoff, y + yoff);
-                mBounds.join(glyphBounds);
                 if (info[i].cluster - start < count) {
                     mAdvances[info[i].cluster - start] += xAdvance;
                 } else {
@@ -861,38 +1544,77 @@ void Layout::doLayoutRun(const uint16_t* buf, size_t start, size_t count, size_t
     mAdvance = x;
 }
 
-void Layout::appendLayout(Layout* src, size_t start) {
+void Layout::appendLayout(const LayoutPiece* src, size_t start, LayoutContext* ctx) {
     int fontMapStack[16];
     int* fontMap;
-    if (src->mFaces.size() < sizeof(fontMapStack) / sizeof(fontMapStack[0])) {
+    if (src->nFaces() < sizeof(fontMapStack) / sizeof(fontMapStack[0])) {
         fontMap = fontMapStack;
     } else {
-        fontMap = new int[src->mFaces.size()];
+        fontMap = ctx->arena.allocateArray<int>(src->nFaces());
     }
-    for (size_t i = 0; i < src->mFaces.size(); i++) {
-        int font_ix = findFace(src->mFaces[i], NULL);
+    for (size_t i = 0; i < src->nFaces(); i++) {
+        int font_ix = findFace(src->getFace(i), NULL);
         fontMap[i] = font_ix;
     }
     int x0 = mAdvance;
-    for (size_t i = 0; i < src->mGlyphs.size(); i++) {
-        LayoutGlyph& srcGlyph = src->mGlyphs[i];
-        int font_ix = fontMap[srcGlyph.font_ix];
-        unsigned int glyph_id = srcGlyph.glyph_id;
-        float x = x0 + srcGlyph.x;
-        float y = srcGlyph.y;
-        LayoutGlyph glyph = {font_ix, glyph_id, x, y};
-        mGlyphs.push_back(glyph);
+    const size_t n = src->nGlyphs();
+    if (mRecordWords) {
+        WordInfo word = {static_cast<uint32_t>(start), static_cast<uint32_t>(mGlyphIds.size()),
+                mAdvance, src->getAdvance()};
+        mWords.push_back(word);
+    }
+    if (mOutput != nullptr) {
+        appendToOutput(src, fontMap, x0);
+    } else if (n > 0) {
+        const size_t dst = mGlyphIds.size();
+        mGlyphIds.resize(dst + n);
+        mGlyphXs.resize(dst + n);
+        mGlyphYs.resize(dst + n);
+        for (size_t i = 0; i < n; i++) {
+            mGlyphIds[dst + i] = src->getGlyphId(i);
+        }
+        offsetPositions(&mGlyphXs[dst], src->getXs(), x0, n);
+        memcpy(&mGlyphYs[dst], src->getYs(), n * sizeof(float));
+        for (size_t run = 0; run < src->nFontRuns(); run++) {
+            const Layout::FontRun& fontRun = src->getFontRun(run);
+            appendFontRun(dst + fontRun.start, fontMap[fontRun.faceIx]);
+        }
     }
-    for (size_t i = 0; i < src->mAdvances.size(); i++) {
-        mAdvances[i + start] = src->mAdvances[i];
+    if (src->nAdvances() > 0) {
+        memcpy(&mAdvances[start], src->getAdvances(), src->nAdvances() * sizeof(float));
     }
-    MinikinRect srcBounds(src->mBounds);
-    srcBounds.offset(x0, 0);
-    mBounds.join(srcBounds);
-    mAdvance += src->mAdvance;
+    mAdvance += src->getAdvance();
+}
 
-    if (fontMap != fontMapStack) {
-        delete[] fontMap;
+void Layout::appendToOutput(const LayoutPiece* src, const int* fontMap, float x0) {
+    GlyphOutputBuffers* out = mOutput;
+    const size_t dst = out->glyphCount;
+    out->glyphCount += src->nGlyphs();
+    if (dst >= out->glyphCapacity) {
+        return;
+    }
+    const size_t n = std::min(src->nGlyphs(), out->glyphCapacity - dst);
+    if (out->glyphIds != nullptr) {
+        for (size_t i = 0; i < n; i++) {
+            out->glyphIds[dst + i] = src->getGlyphId(i);
+        }
+    }
+    if (out->x != nullptr) {
+        offsetPositions(out->x + dst, src->getXs(), x0, n);
+    }
+    if (out->y != nullptr) {
+        memcpy(out->y + dst, src->getYs(), n * sizeof(float));
+    }
+    if (out->fontIndices != nullptr) {
+        for (size_t run = 0; run < src->nFontRuns(); run++) {
+            const size_t runStart = src->getFontRun(run).start;
+            if (runStart >= n) {
+                break;
+            }
+            const size_t runEnd = std::min(src->getFontRunEnd(run), n);
+            std::fill(out->fontIndices + dst + runStart, out->fontIndices + dst + runEnd,
+                    fontMap[src->getFontRun(run).faceIx]);
+        }
     }
 }
 
@@ -905,71 +1627,156 @@ void Layout::draw(minikin::Bitmap* surface, int x0, int y0, float size) const {
         if (hintflags & 2) load_flags |= FT_LOAD_NO_AUTOHINT;
     }
     */
-    for (size_t i = 0; i < mGlyphs.size(); i++) {
-        const LayoutGlyph& glyph = mGlyphs[i];
-        MinikinFont* mf = mFaces[glyph.font_ix].font;
+    for (size_t i = 0; i < mGlyphIds.size(); i++) {
+        MinikinFont* mf = getFont(i);
         MinikinFontFreeType* face = static_cast<MinikinFontFreeType*>(mf);
         GlyphBitmap glyphBitmap;
         MinikinPaint paint;
         paint.size = size;
-        bool ok = face->Render(glyph.glyph_id, paint, &glyphBitmap);
+        bool ok = face->Render(mGlyphIds[i], paint, &glyphBitmap);
 #ifdef VERBOSE_DEBUG
         ALOGD("glyphBitmap.width=%d, glyphBitmap.height=%d (%d, %d) x=%f, y=%f, ok=%d",
-            glyphBitmap.width, glyphBitmap.height, glyphBitmap.left, glyphBitmap.top, glyph.x, glyph.y, ok);
+            glyphBitmap.width, glyphBitmap.height, glyphBitmap.left, glyphBitmap.top, mGlyphXs[i], mGlyphYs[i], ok);
 #endif
         if (ok) {
             surface->drawGlyph(glyphBitmap,
-                x0 + int(floor(glyph.x + 0.5)), y0 + int(floor(glyph.y + 0.5)));
+                x0 + int(floor(mGlyphXs[i] + 0.5)), y0 + int(floor(mGlyphYs[i] + 0.5)));
         }
     }
 }
 
 size_t Layout::nGlyphs() const {
-    return mGlyphs.size();
+    return mGlyphIds.size();
+}
+
+size_t Layout::findFontRun(size_t i) const {
+    // Glyphs are usually visited in order, so try the last run found and its neighbours first.
+    const size_t last = mLastFontRun;
+    if (last < mFontRuns.size()) {
+        if (i >= mFontRuns[last].start) {
+            if (i < getFontRunEnd(last)) {
+                return last;
+            }
+            if (last + 1 < mFontRuns.size() && i < getFontRunEnd(last + 1)) {
+                return mLastFontRun = last + 1;
+            }
+        } else if (last > 0 && i >= mFontRuns[last - 1].start) {
+            return mLastFontRun = last - 1;
+        }
+    }
+    auto it = std::upper_bound(mFontRuns.begin(), mFontRuns.end(), i,
+            [](size_t glyph, const FontRun& run) { return glyph < run.start; });
+    return mLastFontRun = it - mFontRuns.begin() - 1;
 }
 
 MinikinFont* Layout::getFont(int i) const {
-    const LayoutGlyph& glyph = mGlyphs[i];
-    return mFaces[glyph.font_ix].font;
+    return mFaces[mFontRuns[findFontRun(i)].faceIx].font;
 }
 
 FontFakery Layout::getFakery(int i) const {
-    const LayoutGlyph& glyph = mGlyphs[i];
-    return mFaces[glyph.font_ix].fakery;
+    return mFaces[mFontRuns[findFontRun(i)].faceIx].fakery;
+}
+
+LayoutFontRun Layout::getFontRun(size_t runIndex) const {
+    const FakedFont& face = mFaces[mFontRuns[runIndex].faceIx];
+    LayoutFontRun run = {face.font, face.fakery, mFontRuns[runIndex].start,
+            getFontRunEnd(runIndex)};
+    return run;
 }
 
 unsigned int Layout::getGlyphId(int i) const {
-    const LayoutGlyph& glyph = mGlyphs[i];
-    return glyph.glyph_id;
+    return mGlyphIds[i];
 }
 
 float Layout::getX(int i) const {
-    const LayoutGlyph& glyph = mGlyphs[i];
-    return glyph.x;
+    return mGlyphXs[i];
 }
 
 float Layout::getY(int i) const {
-    const LayoutGlyph& glyph = mGlyphs[i];
-    return glyph.y;
+    return mGlyphYs[i];
 }
 
 float Layout::getAdvance() const {
     return mAdvance;
 }
 
-void Layout::getAdvances(float* advances) {
+void Layout::getAdvances(float* advances) const {
     memcpy(advances, &mAdvances[0], mAdvances.size() * sizeof(float));
 }
 
 void Layout::getBounds(MinikinRect* bounds) {
+    if (!mBoundsValid) {
+        ScopedLayoutContext ctx;
+        mBounds.setEmpty();
+        MinikinPaint paint = mPaint;
+        // Collect the non-empty glyph bounds as four edge arrays and join them in one pass.
+        const size_t n = mGlyphIds.size();
+        std::vector<float>& edges = ctx.get()->glyphBounds;
+        edges.resize(4 * n);
+        float* lefts = edges.data();
+        float* tops = lefts + n;
+        float* rights = tops + n;
+        float* bottoms = rights + n;
+        size_t nonEmpty = 0;
+        for (size_t run = 0; run < mFontRuns.size(); run++) {
+            const FakedFont& face = mFaces[mFontRuns[run].faceIx];
+            paint.font = face.font;
+            paint.fakery = face.fakery;
+            const size_t runEnd = getFontRunEnd(run);
+            for (size_t i = mFontRuns[run].start; i < runEnd; i++) {
+                MinikinRect glyphBounds;
+                ctx.get()->glyphMetrics.getBounds(&glyphBounds, mGlyphIds[i], paint);
+                if (glyphBounds.isEmpty()) {
+                    continue;
+                }
+                lefts[nonEmpty] = glyphBounds.mLeft + mGlyphXs[i];
+                tops[nonEmpty] = glyphBounds.mTop + mGlyphYs[i];
+                rights[nonEmpty] = glyphBounds.mRight + mGlyphXs[i];
+                bottoms[nonEmpty] = glyphBounds.mBottom + mGlyphYs[i];
+                nonEmpty++;
+            }
+        }
+        joinRects(lefts, tops, rights, bottoms, nonEmpty, &mBounds);
+        mBoundsValid = true;
+    }
     bounds->set(mBounds);
 }
 
+void Layout::setLayoutThreadCount(size_t threadCount) {
+    std::shared_ptr<ThreadPool> pool;
+    if (threadCount > 0) {
+        pool = std::make_shared<ThreadPool>(threadCount);
+    }
+    LayoutEngine::getInstance().setThreadPool(pool);
+}
+
+void Layout::setLayoutCacheMaxBytes(size_t maxBytes) {
+    LayoutEngine::getInstance().layoutCache.setMaxBytes(maxBytes);
+}
+
+void Layout::setItemizeCacheMaxBytes(size_t maxBytes) {
+    android::setItemizeCacheMaxBytes(maxBytes);
+}
+
+void Layout::getCacheStats(CacheStats* layoutCacheStats, CacheStats* hbFontCacheStats) {
+    if (layoutCacheStats != nullptr) {
+        LayoutEngine::getInstance().layoutCache.getStats(layoutCacheStats);
+    }
+    if (hbFontCacheStats != nullptr) {
+        getHbFontCacheStats(hbFontCacheStats);
+    }
+}
+
+void Layout::resetCacheStats() {
+    LayoutEngine::getInstance().layoutCache.resetStats();
+    resetHbFontCacheStats();
+}
+
 void Layout::purgeCaches() {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
     LayoutCache& layoutCache = LayoutEngine::getInstance().layoutCache;
     layoutCache.clear();
-    purgeHbFontCacheLocked();
+    purgeItemizeCache();
+    purgeHbFontCache();
 }
 
 }  // namespace android
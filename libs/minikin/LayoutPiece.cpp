@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "LayoutPiece.h"
+
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+#include <log/log.h>
+
+namespace android {
+
+static uint32_t alignTo4(size_t offset) {
+    return (offset + 3) & ~3;
+}
+
+LayoutPiece* LayoutPiece::create(const Layout& layout, const uint16_t* text, size_t nchars) {
+    const size_t nFaces = layout.mFaces.size();
+    const size_t nGlyphs = layout.mGlyphIds.size();
+    const size_t nAdvances = layout.mAdvances.size();
+    const size_t nFontRuns = layout.mFontRuns.size();
+    LOG_ALWAYS_FATAL_IF(nFaces > UINT16_MAX, "too many faces in a single word: %zu", nFaces);
+    bool wideGlyphIds = false;
+    for (size_t i = 0; i < nGlyphs; i++) {
+        if (layout.mGlyphIds[i] > UINT16_MAX) {
+            wideGlyphIds = true;
+            break;
+        }
+    }
+
+    // The face table comes first since it has the strictest alignment. All other arrays have
+    // 4 or 2 byte elements and are laid out in decreasing order of alignment.
+    size_t offset = getFacesOffset() + nFaces * sizeof(FakedFont);
+    const uint32_t xOffset = offset;
+    offset += nGlyphs * sizeof(float);
+    const uint32_t yOffset = offset;
+    offset += nGlyphs * sizeof(float);
+    const uint32_t advancesOffset = offset;
+    offset += nAdvances * sizeof(float);
+    const uint32_t fontRunOffset = offset;
+    offset += nFontRuns * sizeof(Layout::FontRun);
+    const uint32_t glyphIdOffset = offset;
+    offset += nGlyphs * (wideGlyphIds ? sizeof(uint32_t) : sizeof(uint16_t));
+    const uint32_t textOffset = offset;
+    offset += nchars * sizeof(uint16_t);
+    const uint32_t bytes = alignTo4(offset);
+
+    void* block = malloc(bytes);
+    LOG_ALWAYS_FATAL_IF(block == nullptr, "failed to allocate %u bytes for a layout piece", bytes);
+    LayoutPiece* piece = new (block) LayoutPiece();
+    piece->mRefCount.store(1, std::memory_order_relaxed);
+    piece->mBytes = bytes;
+    piece->mNFaces = nFaces;
+    piece->mNGlyphs = nGlyphs;
+    piece->mNAdvances = nAdvances;
+    piece->mNFontRuns = nFontRuns;
+    piece->mXOffset = xOffset;
+    piece->mYOffset = yOffset;
+    piece->mAdvancesOffset = advancesOffset;
+    piece->mGlyphIdOffset = glyphIdOffset;
+    piece->mFontRunOffset = fontRunOffset;
+    piece->mTextOffset = textOffset;
+    piece->mWideGlyphIds = wideGlyphIds;
+    piece->mAdvance = layout.mAdvance;
+
+    uint8_t* base = static_cast<uint8_t*>(block);
+    FakedFont* faces = reinterpret_cast<FakedFont*>(base + getFacesOffset());
+    for (size_t i = 0; i < nFaces; i++) {
+        new (&faces[i]) FakedFont(layout.mFaces[i]);
+    }
+    if (nGlyphs > 0) {
+        memcpy(base + xOffset, &layout.mGlyphXs[0], nGlyphs * sizeof(float));
+        memcpy(base + yOffset, &layout.mGlyphYs[0], nGlyphs * sizeof(float));
+    }
+    if (nFontRuns > 0) {
+        memcpy(base + fontRunOffset, &layout.mFontRuns[0], nFontRuns * sizeof(Layout::FontRun));
+    }
+    if (wideGlyphIds) {
+        memcpy(base + glyphIdOffset, &layout.mGlyphIds[0], nGlyphs * sizeof(uint32_t));
+    } else {
+        uint16_t* glyphIds = reinterpret_cast<uint16_t*>(base + glyphIdOffset);
+        for (size_t i = 0; i < nGlyphs; i++) {
+            glyphIds[i] = layout.mGlyphIds[i];
+        }
+    }
+    if (nAdvances > 0) {
+        memcpy(base + advancesOffset, &layout.mAdvances[0], nAdvances * sizeof(float));
+    }
+    if (nchars > 0) {
+        memcpy(base + textOffset, text, nchars * sizeof(uint16_t));
+    }
+    return piece;
+}
+
+void LayoutPiece::unref() const {
+    if (mRefCount.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        // FakedFont and the header are trivially destructible.
+        free(const_cast<LayoutPiece*>(this));
+    }
+}
+
+}  // namespace android
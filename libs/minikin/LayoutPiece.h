@@ -0,0 +1,118 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_LAYOUT_PIECE_H
+#define MINIKIN_LAYOUT_PIECE_H
+
+#include <atomic>
+#include <stdint.h>
+
+#include <minikin/Layout.h>
+
+namespace android {
+
+// The shaped result of a single word, as stored in the layout cache.
+//
+// Everything lives in one malloc'ed block: the header below, followed by the face table, the glyph
+// positions, the per-character advances, the font runs, the glyph ids (16 bits each unless a glyph
+// id does not fit) and finally the text of the cache key. A piece is immutable
+// once created and is reference counted, so it can be used after it has been evicted from the
+// cache by another thread.
+class LayoutPiece {
+public:
+    // Creates a piece with a reference count of one. text and nchars are the context of the
+    // cache key, which is stored in the piece so the key can point to it.
+    static LayoutPiece* create(const Layout& layout, const uint16_t* text, size_t nchars);
+
+    void ref() const {
+        mRefCount.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void unref() const;
+
+    // Size of the block, in bytes.
+    size_t getMemoryUsage() const { return mBytes; }
+
+    const uint16_t* getText() const { return reinterpret_cast<const uint16_t*>(at(mTextOffset)); }
+
+    size_t nFaces() const { return mNFaces; }
+    const FakedFont& getFace(size_t i) const {
+        return reinterpret_cast<const FakedFont*>(at(getFacesOffset()))[i];
+    }
+
+    size_t nGlyphs() const { return mNGlyphs; }
+    uint32_t getGlyphId(size_t i) const {
+        if (mWideGlyphIds) {
+            return reinterpret_cast<const uint32_t*>(at(mGlyphIdOffset))[i];
+        }
+        return reinterpret_cast<const uint16_t*>(at(mGlyphIdOffset))[i];
+    }
+    // Font runs, with face indices into the face table of the piece.
+    size_t nFontRuns() const { return mNFontRuns; }
+    const Layout::FontRun& getFontRun(size_t i) const {
+        return reinterpret_cast<const Layout::FontRun*>(at(mFontRunOffset))[i];
+    }
+    size_t getFontRunEnd(size_t i) const {
+        return i + 1 < mNFontRuns ? getFontRun(i + 1).start : mNGlyphs;
+    }
+    float getX(size_t i) const { return getXs()[i]; }
+    float getY(size_t i) const { return getYs()[i]; }
+    const float* getXs() const { return reinterpret_cast<const float*>(at(mXOffset)); }
+    const float* getYs() const { return reinterpret_cast<const float*>(at(mYOffset)); }
+
+    size_t nAdvances() const { return mNAdvances; }
+    const float* getAdvances() const {
+        return reinterpret_cast<const float*>(at(mAdvancesOffset));
+    }
+
+    float getAdvance() const { return mAdvance; }
+
+private:
+    LayoutPiece() {}
+    ~LayoutPiece() {}
+
+    // The face table directly follows the header.
+    static size_t getFacesOffset() {
+        return (sizeof(LayoutPiece) + alignof(FakedFont) - 1) & ~(alignof(FakedFont) - 1);
+    }
+
+    const uint8_t* at(uint32_t offset) const {
+        return reinterpret_cast<const uint8_t*>(this) + offset;
+    }
+
+    mutable std::atomic<int> mRefCount;
+    uint32_t mBytes;
+    uint32_t mNFaces;
+    uint32_t mNGlyphs;
+    uint32_t mNAdvances;
+    uint32_t mNFontRuns;
+    uint32_t mXOffset;
+    uint32_t mYOffset;
+    uint32_t mAdvancesOffset;
+    uint32_t mGlyphIdOffset;
+    uint32_t mFontRunOffset;
+    uint32_t mTextOffset;
+    bool mWideGlyphIds;
+    float mAdvance;
+
+    // disallow copy and assign
+    LayoutPiece(const LayoutPiece&);
+    void operator=(const LayoutPiece&);
+};
+
+}  // namespace android
+
+#endif  // MINIKIN_LAYOUT_PIECE_H
@@ -18,6 +18,11 @@
 
 #include "LayoutUtils.h"
 
+#include <algorithm>
+#include <string.h>
+
+#include "Utf8Utils.h"
+
 /**
  * For the purpose of layout, a word break is a boundary with no
  * kerning or complex script processing. This is necessarily a
@@ -74,3 +79,54 @@ size_t getNextWordBreakForCache(
     }
     return len;
 }
+
+// A code point before which there is a word break for getPrevWordBreakForCache and
+// getNextWordBreakForCache. Supplementary code points never are one, like their surrogates.
+static bool startsWordUtf8(const uint8_t* chars, size_t offset, size_t len) {
+    if ((chars[offset] & 0xC0) == 0x80) {
+        // Not the first byte of a code point.
+        return false;
+    }
+    return isWordBreakBefore(android::nextUtf8CodePoint(chars, &offset, len));
+}
+
+size_t getPrevWordStartUtf8(const uint8_t* chars, size_t offset, size_t len) {
+    for (size_t i = std::min(offset, len); i > 0; i--) {
+        if (i < len && startsWordUtf8(chars, i, len)) {
+            return i;
+        }
+    }
+    return 0;
+}
+
+size_t getNextWordStartUtf8(const uint8_t* chars, size_t offset, size_t len) {
+    for (size_t i = offset; i < len; i++) {
+        if (startsWordUtf8(chars, i, len)) {
+            return i;
+        }
+    }
+    return len;
+}
+
+/**
+ * Multiplicative hash over 64 bits at a time; considerably cheaper than mixing one UTF-16 unit
+ * at a time with JenkinsHashMixShorts.
+ */
+uint32_t hashText(const uint16_t* chars, size_t nchars) {
+    const uint64_t kMul = 0x9E3779B97F4A7C15ULL;
+    uint64_t hash = nchars * kMul;
+    size_t i = 0;
+    for (; i + 4 <= nchars; i += 4) {
+        uint64_t v;
+        memcpy(&v, chars + i, sizeof(v));
+        hash = (hash ^ v) * kMul;
+        hash ^= hash >> 29;
+    }
+    uint64_t tail = 0;
+    for (; i < nchars; i++) {
+        tail = (tail << 16) | chars[i];
+    }
+    hash = (hash ^ tail) * kMul;
+    hash ^= hash >> 32;
+    return static_cast<uint32_t>(hash);
+}
@@ -40,4 +40,23 @@ size_t getPrevWordBreakForCache(
 size_t getNextWordBreakForCache(
         const uint16_t* chars, size_t offset, size_t len);
 
+/**
+ * For UTF-8 text: return the offset of the last code point at or before offset that always has
+ * a word break for the cache before it, such as a space or an ideograph, or 0. The cache words
+ * of the text from offset on never reach before it, so only the text after it needs to be
+ * converted to UTF-16 to find them.
+ */
+size_t getPrevWordStartUtf8(const uint8_t* chars, size_t offset, size_t len);
+
+/**
+ * For UTF-8 text: return the offset of the first such code point at or after offset, or len.
+ * The cache words of the text before offset never reach past it.
+ */
+size_t getNextWordStartUtf8(const uint8_t* chars, size_t offset, size_t len);
+
+/**
+ * Return a hash of the text, for the keys of the caches that are indexed by text.
+ */
+uint32_t hashText(const uint16_t* chars, size_t nchars);
+
 #endif  // MINIKIN_LAYOUT_UTILS_H
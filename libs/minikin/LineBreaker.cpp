@@ -24,6 +24,7 @@
 
 #include <minikin/Layout.h>
 #include <minikin/LineBreaker.h>
+#include "Utf8Utils.h"
 
 using std::vector;
 
@@ -61,6 +62,8 @@ void LineBreaker::setLocale(const icu::Locale& locale, Hyphenator* hyphenator) {
 }
 
 void LineBreaker::setText() {
+    mIsUtf8 = false;
+    mBreaksUtf8.clear();
     mWordBreaker.setText(mTextBuf.data(), mTextBuf.size());
 
     // handle initial break here because addStyleRun may never be called
@@ -80,6 +83,27 @@ void LineBreaker::setText() {
     mFirstTabIndex = INT_MAX;
 }
 
+void LineBreaker::setTextUtf8(const uint8_t* text, size_t length) {
+    transcodeUtf8(text, length, &mTextBuf, &mUtf16ToUtf8, &mUtf8ToUtf16);
+    mCharWidths.resize(mTextBuf.size());
+    setText();
+    mIsUtf8 = true;
+}
+
+float LineBreaker::addStyleRunUtf8(MinikinPaint* paint, const FontCollection* typeface,
+        FontStyle style, size_t start, size_t end, bool isRtl) {
+    return addStyleRun(paint, typeface, style, mUtf8ToUtf16[start], mUtf8ToUtf16[end], isRtl);
+}
+
+void LineBreaker::addReplacementUtf8(size_t start, size_t end, float width) {
+    addReplacement(mUtf8ToUtf16[start], mUtf8ToUtf16[end], width);
+}
+
+void LineBreaker::getCharWidthsUtf8(float* widths) const {
+    utf16ToUtf8Advances(mUtf16ToUtf8, mCharWidths.data(), 0, mCharWidths.size(), widths, 0,
+            mUtf8ToUtf16.size() - 1);
+}
+
 void LineBreaker::setLineWidths(float firstWidth, int firstWidthLineCount, float restWidth) {
     mLineWidths.setWidths(firstWidth, firstWidthLineCount, restWidth);
 }
@@ -414,6 +438,12 @@ size_t LineBreaker::computeBreaks() {
     } else {
         computeBreaksOptimal(mLineWidths.isConstant());
     }
+    if (mIsUtf8) {
+        mBreaksUtf8.resize(mBreaks.size());
+        for (size_t i = 0; i < mBreaks.size(); i++) {
+            mBreaksUtf8[i] = mUtf16ToUtf8[mBreaks[i]];
+        }
+    }
     return mBreaks.size();
 }
 
@@ -425,6 +455,7 @@ void LineBreaker::finish() {
     mBreaks.clear();
     mWidths.clear();
     mFlags.clear();
+    mBreaksUtf8.clear();
     if (mTextBuf.size() > MAX_TEXT_BUF_RETAIN) {
         mTextBuf.clear();
         mTextBuf.shrink_to_fit();
@@ -20,7 +20,7 @@
 namespace android {
 
 MinikinFont::~MinikinFont() {
-    purgeHbFontLocked(this);
+    purgeHbFont(this);
 }
 
 }  // namespace android
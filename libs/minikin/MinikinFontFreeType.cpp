@@ -27,10 +27,10 @@
 
 namespace android {
 
-int32_t MinikinFontFreeType::sIdCounter = 0;
+std::atomic<int32_t> MinikinFontFreeType::sIdCounter(0);
 
-MinikinFontFreeType::MinikinFontFreeType(FT_Face typeface) : 
-    MinikinFont(sIdCounter++),
+MinikinFontFreeType::MinikinFontFreeType(FT_Face typeface) :
+    MinikinFont(sIdCounter.fetch_add(1, std::memory_order_relaxed)),
     mTypeface(typeface) {
 }
 
@@ -40,6 +40,7 @@ MinikinFontFreeType::~MinikinFontFreeType() {
 
 float MinikinFontFreeType::GetHorizontalAdvance(uint32_t glyph_id,
     const MinikinPaint &paint) const {
+    std::lock_guard<std::mutex> _l(mFaceMutex);
     FT_Set_Pixel_Sizes(mTypeface, 0, paint.size);
     FT_UInt32 flags = FT_LOAD_DEFAULT;  // TODO: respect hinting settings
     FT_Fixed advance;
@@ -53,6 +54,7 @@ void MinikinFontFreeType::GetBounds(MinikinRect* /* bounds */, uint32_t /* glyph
 }
 
 const void* MinikinFontFreeType::GetTable(uint32_t tag, size_t* size, MinikinDestroyFunc* destroy) {
+    std::lock_guard<std::mutex> _l(mFaceMutex);
     FT_ULong ftsize = 0;
     FT_Error error = FT_Load_Sfnt_Table(mTypeface, tag, 0, nullptr, &ftsize);
     if (error != 0) {
@@ -74,6 +76,7 @@ const void* MinikinFontFreeType::GetTable(uint32_t tag, size_t* size, MinikinDes
 
 bool MinikinFontFreeType::Render(uint32_t glyph_id, const MinikinPaint& /* paint */,
         GlyphBitmap *result) {
+    std::lock_guard<std::mutex> _l(mFaceMutex);
     FT_Error error;
     FT_Int32 load_flags = FT_LOAD_DEFAULT;  // TODO: respect hinting settings
     error = FT_Load_Glyph(mTypeface, glyph_id, load_flags);
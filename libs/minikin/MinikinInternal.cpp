@@ -25,14 +25,6 @@
 
 namespace android {
 
-std::mutex gMinikinLock;
-
-void assertMinikinLocked() {
-#ifdef ENABLE_RACE_DETECTION
-    LOG_ALWAYS_FATAL_IF(gMinikinLock.tryLock() == 0);
-#endif
-}
-
 bool isEmoji(uint32_t c) {
     // U+2695 U+2640 U+2642 are not in emoji category in Unicode 9 but they are now emoji category.
     // TODO: remove once emoji database is updated.
@@ -86,8 +78,7 @@ bool isEmojiBase(uint32_t c) {
 }
 
 hb_blob_t* getFontTable(MinikinFont* minikinFont, uint32_t tag) {
-    assertMinikinLocked();
-    hb_font_t* font = getHbFontLocked(minikinFont);
+    hb_font_t* font = getHbFont(minikinFont);
     hb_face_t* face = hb_font_get_face(font);
     hb_blob_t* blob = hb_face_reference_table(face, tag);
     hb_font_destroy(font);
@@ -19,8 +19,6 @@
 #ifndef MINIKIN_INTERNAL_H
 #define MINIKIN_INTERNAL_H
 
-#include <mutex>
-
 #include <hb.h>
 
 #include <minikin/MinikinFont.h>
@@ -28,13 +26,9 @@
 namespace android {
 
 // All external Minikin interfaces are designed to be thread-safe.
-// Presently, that's implemented by through a global lock, and having
-// all external interfaces take that lock.
-
-extern std::mutex gMinikinLock;
-
-// Aborts if gMinikinLock is not acquired. Do nothing on the release build.
-void assertMinikinLocked();
+// There is no global lock: each shared cache (LayoutCache, HbFontCache, FontLanguageListCache)
+// does its own synchronization, and per-call layout state is owned by the calling thread.
+// Objects such as FontFamily and FontCollection are immutable once they have been shared.
 
 // Returns true if c is emoji.
 bool isEmoji(uint32_t c);
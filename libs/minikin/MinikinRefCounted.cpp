@@ -16,20 +16,19 @@
 
 // Base class for reference counted objects in Minikin
 
-#include "MinikinInternal.h"
-
 #include <minikin/MinikinRefCounted.h>
 
 namespace android {
 
 void MinikinRefCounted::Ref() {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
-    this->RefLocked();
+    mRefcount_.fetch_add(1, std::memory_order_relaxed);
 }
 
 void MinikinRefCounted::Unref() {
-    std::lock_guard<std::mutex> _l(gMinikinLock);
-    this->UnrefLocked();
+    // acq_rel so that all writes made through other references are visible to the destructor.
+    if (mRefcount_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+        delete this;
+    }
 }
 
 }
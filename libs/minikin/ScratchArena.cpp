@@ -0,0 +1,84 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define LOG_TAG "Minikin"
+
+#include "ScratchArena.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+#include <log/log.h>
+
+namespace android {
+
+static const size_t kMinBlockSize = 4096;
+// Larger blocks are freed by reset() instead of being kept for the next call.
+static const size_t kMaxRetainedSize = 256 * 1024;
+
+ScratchArena::~ScratchArena() {
+    reset();
+    free(mBlock);
+}
+
+void* ScratchArena::allocate(size_t size, size_t alignment) {
+    LOG_ALWAYS_FATAL_IF(alignment > kHeaderSize, "unsupported scratch alignment %zu", alignment);
+    size_t offset = (mUsed + alignment - 1) & ~(alignment - 1);
+    if (offset + size > mBlockSize) {
+        // Retire the current block; it stays valid until the next reset.
+        if (mBlock != nullptr) {
+            Overflow* overflow = reinterpret_cast<Overflow*>(mBlock);
+            overflow->next = mOverflow;
+            mOverflow = overflow;
+            mOverflowBytes += mBlockSize;
+        }
+        mBlockSize = std::max(kMinBlockSize, std::max(2 * mBlockSize, kHeaderSize + size));
+        mBlock = static_cast<uint8_t*>(malloc(mBlockSize));
+        LOG_ALWAYS_FATAL_IF(mBlock == nullptr, "failed to allocate %zu scratch bytes",
+                mBlockSize);
+        offset = kHeaderSize;
+    }
+    mUsed = offset + size;
+    return mBlock + offset;
+}
+
+void ScratchArena::reset() {
+    if (mOverflow != nullptr) {
+        // The work since the last reset did not fit into one block. Replace all blocks by one
+        // that is large enough, so the next call of the same size allocates nothing.
+        const size_t totalBytes = mOverflowBytes + mBlockSize;
+        while (mOverflow != nullptr) {
+            Overflow* next = mOverflow->next;
+            free(mOverflow);
+            mOverflow = next;
+        }
+        mOverflowBytes = 0;
+        free(mBlock);
+        mBlock = nullptr;
+        mBlockSize = 0;
+        if (totalBytes <= kMaxRetainedSize) {
+            mBlock = static_cast<uint8_t*>(malloc(totalBytes));
+            mBlockSize = mBlock == nullptr ? 0 : totalBytes;
+        }
+    } else if (mBlockSize > kMaxRetainedSize) {
+        free(mBlock);
+        mBlock = nullptr;
+        mBlockSize = 0;
+    }
+    mUsed = kHeaderSize;
+}
+
+}  // namespace android
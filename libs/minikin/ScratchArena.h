@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_SCRATCH_ARENA_H
+#define MINIKIN_SCRATCH_ARENA_H
+
+#include <cstddef>
+#include <stdint.h>
+
+namespace android {
+
+// Bump allocator for temporary data that lives until the end of a layout call. Memory is only
+// released all at once by reset(). After a reset, the arena keeps a single block large enough
+// for everything allocated since the previous reset, so repeating the same work does not call
+// malloc again.
+//
+// Not thread safe; each LayoutContext has its own arena.
+class ScratchArena {
+public:
+    ScratchArena() : mBlock(nullptr), mBlockSize(0), mUsed(kHeaderSize), mOverflow(nullptr),
+            mOverflowBytes(0) {}
+    ~ScratchArena();
+
+    // alignment must be a power of two, no larger than that of std::max_align_t.
+    void* allocate(size_t size, size_t alignment);
+
+    template <typename T>
+    T* allocateArray(size_t n) {
+        return static_cast<T*>(allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void reset();
+
+private:
+    // Blocks that no longer fit the current allocation are chained through their first bytes,
+    // which are never handed out.
+    struct Overflow {
+        Overflow* next;
+    };
+
+    static const size_t kHeaderSize = alignof(std::max_align_t);
+
+    uint8_t* mBlock;
+    size_t mBlockSize;
+    size_t mUsed;
+    Overflow* mOverflow;
+    size_t mOverflowBytes;
+
+    // disallow copy and assign
+    ScratchArena(const ScratchArena&);
+    void operator=(const ScratchArena&);
+};
+
+// STL allocator drawing from a ScratchArena, for containers that live within one layout call.
+// Deallocation is a no-op; the memory is reclaimed by the next reset of the arena.
+template <typename T>
+class ScratchAllocator {
+public:
+    typedef T value_type;
+
+    explicit ScratchAllocator(ScratchArena* arena) : mArena(arena) {}
+
+    template <typename U>
+    ScratchAllocator(const ScratchAllocator<U>& other) : mArena(other.mArena) {}
+
+    T* allocate(size_t n) { return mArena->allocateArray<T>(n); }
+    void deallocate(T*, size_t) {}
+
+    template <typename U>
+    bool operator==(const ScratchAllocator<U>& other) const { return mArena == other.mArena; }
+    template <typename U>
+    bool operator!=(const ScratchAllocator<U>& other) const { return mArena != other.mArena; }
+
+private:
+    template <typename U> friend class ScratchAllocator;
+    ScratchArena* mArena;
+};
+
+}  // namespace android
+
+#endif  // MINIKIN_SCRATCH_ARENA_H
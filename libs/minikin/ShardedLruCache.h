@@ -0,0 +1,178 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_SHARDED_LRU_CACHE_H
+#define MINIKIN_SHARDED_LRU_CACHE_H
+
+#include <atomic>
+#include <mutex>
+#include <stdint.h>
+
+#include <utils/LruCache.h>
+
+#include <minikin/Layout.h>
+
+namespace android {
+
+// An LruCache split into shards, each with its own lock and LRU list, so that threads working on
+// different keys rarely contend. Eviction is driven by the estimated memory footprint of the
+// entries; each shard gets an equal part of the byte budget. Used by the layout cache and the
+// itemization cache.
+//
+// TKey must provide hash() and getTextLength(). Policy provides
+//     static size_t getMemoryUsage(const TKey& key, const TValue& value);
+//     static void onEntryRemoved(TKey& key, TValue& value);
+// where getMemoryUsage must return the bytes the entry was put with, and onEntryRemoved releases
+// the value when it leaves the cache.
+template <typename TKey, typename TValue, typename Policy>
+class ShardedLruCache {
+public:
+    explicit ShardedLruCache(size_t maxBytes) : mMaxBytes(maxBytes) {
+    }
+
+    size_t getMaxBytes() const {
+        return mMaxBytes.load(std::memory_order_relaxed);
+    }
+
+    void setMaxBytes(size_t maxBytes) {
+        mMaxBytes.store(maxBytes, std::memory_order_relaxed);
+        const size_t shardMaxBytes = getShardMaxBytes();
+        for (size_t i = 0; i < kNumShards; i++) {
+            Shard& shard = mShards[i];
+            std::lock_guard<std::mutex> _l(shard.mutex);
+            shard.trimLocked(shardMaxBytes);
+        }
+    }
+
+    void clear() {
+        for (size_t i = 0; i < kNumShards; i++) {
+            Shard& shard = mShards[i];
+            std::lock_guard<std::mutex> _l(shard.mutex);
+            shard.cache.clear();
+        }
+    }
+
+    // Calls onHit(value) with the shard locked if the key is cached, and returns whether it was.
+    template <typename OnHit>
+    bool get(const TKey& key, OnHit onHit) {
+        Shard& shard = getShard(key);
+        std::lock_guard<std::mutex> _l(shard.mutex);
+        const TValue& value = shard.cache.get(key);
+        if (value == nullptr) {
+            return false;
+        }
+        shard.hits++;
+        onHit(value);
+        return true;
+    }
+
+    // Records a miss that took missNanos to compute. Unless another thread added the key in the
+    // meantime or bytes exceeds the budget of a shard, then stores the value returned by
+    // create(&key), which may point the key at data owned by the value.
+    template <typename Create>
+    void put(TKey& key, size_t bytes, uint64_t missNanos, Create create) {
+        Shard& shard = getShard(key);
+        const size_t shardMaxBytes = getShardMaxBytes();
+        std::lock_guard<std::mutex> _l(shard.mutex);
+        shard.misses++;
+        shard.missNanos += missNanos;
+        if (bytes > shardMaxBytes || shard.cache.get(key) != nullptr) {
+            return;
+        }
+        const TValue value = create(&key);
+        shard.cache.put(key, value);
+        shard.bytes += bytes;
+        shard.totalKeyLength += key.getTextLength();
+        shard.trimLocked(shardMaxBytes);
+    }
+
+    void getStats(CacheStats* stats) {
+        *stats = CacheStats();
+        for (size_t i = 0; i < kNumShards; i++) {
+            Shard& shard = mShards[i];
+            std::lock_guard<std::mutex> _l(shard.mutex);
+            stats->hits += shard.hits;
+            stats->misses += shard.misses;
+            stats->evictions += shard.evictions;
+            stats->entries += shard.cache.size();
+            stats->bytes += shard.bytes;
+            stats->totalKeyLength += shard.totalKeyLength;
+            stats->missNanos += shard.missNanos;
+        }
+    }
+
+    void resetStats() {
+        for (size_t i = 0; i < kNumShards; i++) {
+            Shard& shard = mShards[i];
+            std::lock_guard<std::mutex> _l(shard.mutex);
+            shard.hits = 0;
+            shard.misses = 0;
+            shard.evictions = 0;
+            shard.missNanos = 0;
+        }
+    }
+
+private:
+    class Shard : private OnEntryRemoved<TKey, TValue> {
+    public:
+        Shard() : cache(LruCache<TKey, TValue>::kUnlimitedCapacity), bytes(0), totalKeyLength(0),
+                hits(0), misses(0), evictions(0), missNanos(0) {
+            cache.setOnEntryRemovedListener(this);
+        }
+
+        void trimLocked(size_t maxBytes) {
+            while (bytes > maxBytes && cache.removeOldest()) {
+                evictions++;
+            }
+        }
+
+        std::mutex mutex;  // guards all the fields below
+        LruCache<TKey, TValue> cache;
+        size_t bytes;
+        size_t totalKeyLength;
+        uint64_t hits;
+        uint64_t misses;
+        uint64_t evictions;
+        uint64_t missNanos;
+
+    private:
+        // callback for OnEntryRemoved
+        void operator()(TKey& key, TValue& value) {
+            bytes -= Policy::getMemoryUsage(key, value);
+            totalKeyLength -= key.getTextLength();
+            Policy::onEntryRemoved(key, value);
+        }
+    };
+
+    Shard& getShard(const TKey& key) {
+        // The low bits of the hash pick the bucket inside the shard, so use the high bits here.
+        return mShards[static_cast<uint32_t>(key.hash()) >> (32 - kShardBits)];
+    }
+
+    size_t getShardMaxBytes() const {
+        return getMaxBytes() / kNumShards;
+    }
+
+    static const size_t kShardBits = 4;
+    static const size_t kNumShards = 1 << kShardBits;
+
+    Shard mShards[kNumShards];
+    std::atomic<size_t> mMaxBytes;
+};
+
+}  // namespace android
+
+#endif  // MINIKIN_SHARDED_LRU_CACHE_H
@@ -0,0 +1,100 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ThreadPool.h"
+
+namespace android {
+
+ThreadPool::ThreadPool(size_t threadCount)
+        : mBusy(false), mJob(nullptr), mGeneration(0), mActiveWorkers(0), mStop(false) {
+    for (size_t i = 0; i < threadCount; i++) {
+        mThreads.emplace_back(&ThreadPool::workerLoop, this);
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> _l(mMutex);
+        mStop = true;
+    }
+    mWorkCondition.notify_all();
+    for (std::thread& thread : mThreads) {
+        thread.join();
+    }
+}
+
+void ThreadPool::runJob(Job* job) {
+    size_t i;
+    while ((i = job->next.fetch_add(1, std::memory_order_relaxed)) < job->n) {
+        (*job->f)(i);
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)>& f) {
+    bool expected = false;
+    if (n < 2 || mThreads.empty()
+            || !mBusy.compare_exchange_strong(expected, true, std::memory_order_acquire)) {
+        for (size_t i = 0; i < n; i++) {
+            f(i);
+        }
+        return;
+    }
+
+    Job job;
+    job.f = &f;
+    job.n = n;
+    job.next.store(0, std::memory_order_relaxed);
+    {
+        std::lock_guard<std::mutex> _l(mMutex);
+        mJob = &job;
+        mGeneration++;
+    }
+    mWorkCondition.notify_all();
+    runJob(&job);
+
+    std::unique_lock<std::mutex> lock(mMutex);
+    // Workers that have not picked up the job yet will skip it.
+    mJob = nullptr;
+    mDoneCondition.wait(lock, [this] { return mActiveWorkers == 0; });
+    mBusy.store(false, std::memory_order_release);
+}
+
+void ThreadPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+    while (true) {
+        mWorkCondition.wait(lock, [this, seenGeneration] {
+            return mStop || mGeneration != seenGeneration;
+        });
+        if (mStop) {
+            return;
+        }
+        seenGeneration = mGeneration;
+        Job* job = mJob;
+        if (job == nullptr) {
+            continue;
+        }
+        mActiveWorkers++;
+        lock.unlock();
+        runJob(job);
+        lock.lock();
+        if (--mActiveWorkers == 0) {
+            mDoneCondition.notify_all();
+        }
+    }
+}
+
+}  // namespace android
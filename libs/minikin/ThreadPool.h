@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_THREAD_POOL_H
+#define MINIKIN_THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace android {
+
+// A fixed set of worker threads for running independent layout work in parallel.
+class ThreadPool {
+public:
+    explicit ThreadPool(size_t threadCount);
+    ~ThreadPool();
+
+    // Calls f(i) for every i in [0, n), spreading the calls over the workers and the calling
+    // thread, and returns once all of them are done. Indices are handed out one at a time from
+    // a shared counter, so threads that finish early pick up the remaining work. If the pool is
+    // already running a job (e.g. parallelFor is called from inside f), the calls are made
+    // serially on the calling thread instead.
+    void parallelFor(size_t n, const std::function<void(size_t)>& f);
+
+    size_t getThreadCount() const { return mThreads.size(); }
+
+private:
+    struct Job {
+        const std::function<void(size_t)>* f;
+        size_t n;
+        std::atomic<size_t> next;
+    };
+
+    static void runJob(Job* job);
+    void workerLoop();
+
+    // Set by the caller of parallelFor for the duration of a job. An atomic flag rather than a
+    // mutex, since a nested parallelFor on the same thread must see it without relocking.
+    std::atomic<bool> mBusy;
+
+    std::mutex mMutex;  // guards the fields below
+    std::condition_variable mWorkCondition;
+    std::condition_variable mDoneCondition;
+    Job* mJob;
+    uint64_t mGeneration;
+    size_t mActiveWorkers;
+    bool mStop;
+
+    std::vector<std::thread> mThreads;
+
+    // disallow copy and assign
+    ThreadPool(const ThreadPool&);
+    void operator=(const ThreadPool&);
+};
+
+}  // namespace android
+
+#endif  // MINIKIN_THREAD_POOL_H
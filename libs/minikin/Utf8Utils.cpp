@@ -0,0 +1,67 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "Utf8Utils.h"
+
+#include <algorithm>
+
+#include <unicode/utf8.h>
+#include <unicode/utf16.h>
+
+namespace android {
+
+uint32_t nextUtf8CodePoint(const uint8_t* text, size_t* offset, size_t length) {
+    int32_t i = *offset;
+    int32_t c;
+    U8_NEXT(text, i, static_cast<int32_t>(length), c);
+    *offset = i;
+    return c < 0 ? 0xFFFD : c;
+}
+
+void transcodeUtf8(const uint8_t* text, size_t length, std::vector<uint16_t>* utf16,
+        std::vector<uint32_t>* utf16ToUtf8, std::vector<uint32_t>* utf8ToUtf16) {
+    utf16->clear();
+    utf16ToUtf8->clear();
+    utf8ToUtf16->resize(length + 1);
+    size_t offset = 0;
+    while (offset < length) {
+        const size_t cpStart = offset;
+        const uint32_t c = nextUtf8CodePoint(text, &offset, length);
+        std::fill(utf8ToUtf16->begin() + cpStart, utf8ToUtf16->begin() + offset, utf16->size());
+        if (U_IS_BMP(c)) {
+            utf16->push_back(c);
+            utf16ToUtf8->push_back(cpStart);
+        } else {
+            utf16->push_back(U16_LEAD(c));
+            utf16->push_back(U16_TRAIL(c));
+            utf16ToUtf8->push_back(cpStart);
+            utf16ToUtf8->push_back(cpStart);
+        }
+    }
+    (*utf8ToUtf16)[length] = utf16->size();
+    utf16ToUtf8->push_back(length);
+}
+
+void utf16ToUtf8Advances(const std::vector<uint32_t>& utf16ToUtf8, const float* utf16Advances,
+        size_t utf16Start, size_t utf16Count, float* utf8Advances, size_t utf8Start,
+        size_t utf8Count) {
+    std::fill(utf8Advances, utf8Advances + utf8Count, 0.0f);
+    for (size_t i = 0; i < utf16Count; i++) {
+        utf8Advances[utf16ToUtf8[utf16Start + i] - utf8Start] += utf16Advances[i];
+    }
+}
+
+}  // namespace android
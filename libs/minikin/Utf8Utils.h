@@ -0,0 +1,64 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef MINIKIN_UTF8_UTILS_H
+#define MINIKIN_UTF8_UTILS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include <vector>
+
+namespace android {
+
+// Decodes the code point starting at text[*offset] and advances *offset past it. Malformed
+// sequences decode to U+FFFD.
+uint32_t nextUtf8CodePoint(const uint8_t* text, size_t* offset, size_t length);
+
+// Writes the UTF-16 form of text into utf16. utf16ToUtf8 gets, for each UTF-16 unit, the byte
+// offset of its code point, and utf8ToUtf16 gets, for each byte, the UTF-16 offset of the code
+// point containing it. Both maps have one extra entry for the end of the text.
+void transcodeUtf8(const uint8_t* text, size_t length, std::vector<uint16_t>* utf16,
+        std::vector<uint32_t>* utf16ToUtf8, std::vector<uint32_t>* utf8ToUtf16);
+
+// Converts per-UTF-16-unit advances of [utf16Start, utf16Start + utf16Count) into per-byte
+// advances of the corresponding bytes starting at utf8Start. The advance of each code point goes
+// to its first byte; the other bytes get 0.
+void utf16ToUtf8Advances(const std::vector<uint32_t>& utf16ToUtf8, const float* utf16Advances,
+        size_t utf16Start, size_t utf16Count, float* utf8Advances, size_t utf8Start,
+        size_t utf8Count);
+
+// UTF-16 copy of a UTF-8 string, with offset maps in both directions. The vectors keep their
+// capacity, so an object that is reused does not allocate once it has seen its longest string.
+struct Utf8Transcoder {
+    std::vector<uint16_t> utf16;
+    std::vector<uint32_t> utf16ToUtf8;
+    std::vector<uint32_t> utf8ToUtf16;
+
+    void transcode(const uint8_t* text, size_t length) {
+        transcodeUtf8(text, length, &utf16, &utf16ToUtf8, &utf8ToUtf16);
+    }
+
+    void toUtf8Advances(const float* utf16Advances, size_t utf16Start, size_t utf16Count,
+            float* utf8Advances, size_t utf8Start, size_t utf8Count) const {
+        utf16ToUtf8Advances(utf16ToUtf8, utf16Advances, utf16Start, utf16Count, utf8Advances,
+                utf8Start, utf8Count);
+    }
+};
+
+}  // namespace android
+
+#endif  // MINIKIN_UTF8_UTILS_H
@@ -61,14 +61,24 @@ LOCAL_SRC_FILES += \
     FontCollectionTest.cpp \
     FontCollectionItemizeTest.cpp \
     FontFamilyTest.cpp \
+    FontFeatureSettingsCacheTest.cpp \
     FontLanguageListCacheTest.cpp \
     FontTestUtils.cpp \
+    GlyphKernelsTest.cpp \
+    GlyphMetricsCacheTest.cpp \
     HbFontCacheTest.cpp \
+    InternTableTest.cpp \
+    ItemizeCacheTest.cpp \
     MinikinFontForTest.cpp \
     MinikinInternalTest.cpp \
     GraphemeBreakTests.cpp \
+    LayoutTest.cpp \
     LayoutUtilsTest.cpp \
+    LineBreakerTest.cpp \
+    ScratchArenaTest.cpp \
+    ThreadPoolTest.cpp \
     UnicodeUtils.cpp \
+    Utf8UtilsTest.cpp \
     WordBreakerTests.cpp
 
 LOCAL_C_INCLUDES := \
@@ -23,9 +23,9 @@
 #include "MinikinFontForTest.h"
 #include "MinikinInternal.h"
 #include "UnicodeUtils.h"
+#include "Utf8Utils.h"
 #include "minikin/FontFamily.h"
 
-using android::AutoMutex;
 using android::FontCollection;
 using android::FontFamily;
 using android::FontLanguage;
@@ -34,7 +34,6 @@ using android::FontLanguageListCache;
 using android::FontStyle;
 using android::MinikinAutoUnref;
 using android::MinikinFont;
-using android::gMinikinLock;
 
 const char kItemizeFontXml[] = kTestFontDir "itemize.xml";
 const char kEmojiFont[] = kTestFontDir "Emoji.ttf";
@@ -64,7 +63,6 @@ void itemize(FontCollection* collection, const char* str, FontStyle style,
 
     result->clear();
     ParseUnicode(buf, BUF_SIZE, str, &len, NULL);
-    AutoMutex _l(gMinikinLock);
     collection->itemize(buf, len, style, result);
 }
 
@@ -76,7 +74,6 @@ const std::string& getFontPath(const FontCollection::Run& run) {
 
 // Utility function to obtain FontLanguages from string.
 const FontLanguages& registerAndGetFontLanguages(const std::string& lang_string) {
-    AutoMutex _l(gMinikinLock);
     return FontLanguageListCache::getById(FontLanguageListCache::getId(lang_string));
 }
 
@@ -339,6 +336,30 @@ TEST_F(FontCollectionItemizeTest, itemize_mixed) {
     EXPECT_FALSE(runs[4].fakedFont.fakery.isFakeItalic());
 }
 
+TEST_F(FontCollectionItemizeTest, itemize_longLatinSpan) {
+    MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
+    std::vector<FontCollection::Run> runs;
+
+    FontStyle kUSStyle = FontStyle(FontStyle::registerLanguageList("en_US"));
+
+    // Long enough for the Latin-1 fast path to extend the run over several characters at once.
+    itemize(collection.get(),
+            "'a' 'b' 'c' 'd' 'e' 'a' 'b' 'c' 'd' 'e' 'a' 'b' 'c' 'd' 'e' 'a' 'b' U+4F60 'c' 'd'",
+            kUSStyle, &runs);
+    ASSERT_EQ(3U, runs.size());
+    EXPECT_EQ(0, runs[0].start);
+    EXPECT_EQ(17, runs[0].end);
+    EXPECT_EQ(kLatinFont, getFontPath(runs[0]));
+
+    EXPECT_EQ(17, runs[1].start);
+    EXPECT_EQ(18, runs[1].end);
+    EXPECT_EQ(kZH_HansFont, getFontPath(runs[1]));
+
+    EXPECT_EQ(18, runs[2].start);
+    EXPECT_EQ(20, runs[2].end);
+    EXPECT_EQ(kLatinFont, getFontPath(runs[2]));
+}
+
 TEST_F(FontCollectionItemizeTest, itemize_variationSelector) {
     MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
     std::vector<FontCollection::Run> runs;
@@ -1397,3 +1418,82 @@ TEST_F(FontCollectionItemizeTest, itemize_genderBalancedEmoji) {
     EXPECT_EQ(4, runs[0].end);
     EXPECT_EQ(kColorEmojiFont, getFontPath(runs[0]));
 }
+
+// Checks that itemizing UTF-8 text gives the runs of its UTF-16 form, with offsets in bytes.
+void expectUtf8RunsMatchUtf16(FontCollection* collection, const char* str, FontStyle style) {
+    SCOPED_TRACE(str);
+    const uint8_t* text = reinterpret_cast<const uint8_t*>(str);
+    const size_t length = strlen(str);
+    std::vector<uint16_t> utf16;
+    std::vector<uint32_t> utf16ToUtf8;
+    std::vector<uint32_t> utf8ToUtf16;
+    android::transcodeUtf8(text, length, &utf16, &utf16ToUtf8, &utf8ToUtf16);
+
+    std::vector<FontCollection::Run> expected;
+    collection->itemize(utf16.data(), utf16.size(), style, &expected);
+    std::vector<FontCollection::Run> runs;
+    collection->itemize(text, length, style, &runs);
+
+    ASSERT_EQ(expected.size(), runs.size());
+    for (size_t i = 0; i < runs.size(); i++) {
+        EXPECT_EQ(static_cast<int>(utf16ToUtf8[expected[i].start]), runs[i].start);
+        EXPECT_EQ(static_cast<int>(utf16ToUtf8[expected[i].end]), runs[i].end);
+        EXPECT_EQ(expected[i].fakedFont.font, runs[i].fakedFont.font);
+    }
+}
+
+TEST_F(FontCollectionItemizeTest, itemize_utf8) {
+    MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
+    const FontStyle kJAStyle = FontStyle(FontStyle::registerLanguageList("ja_JP"));
+
+    // 'a' U+0301, U+3042 and U+242EE, which takes four bytes and a surrogate pair.
+    expectUtf8RunsMatchUtf16(collection.get(), "\x61\xCC\x81\x20\xE3\x81\x82\xF0\xA4\x8B\xAE",
+            kJAStyle);
+    // U+20E3 COMBINING ENCLOSING KEYCAP moves the four bytes of U+1F467 into its run.
+    expectUtf8RunsMatchUtf16(collection.get(),
+            "\xF0\x9F\x91\xA7\xE2\x83\xA3\x20\x30\xE2\x83\xA3\x20\xE3\x81\x82",
+            FontStyle());
+
+    // A lone continuation byte, a truncated sequence and an encoded surrogate each decode to
+    // U+FFFD, as they do when converted to UTF-16.
+    const char* kMalformed = "\x61\x80\x62\xE3\x81\x20\xED\xA0\x80\xE3\x81\x82";
+    expectUtf8RunsMatchUtf16(collection.get(), kMalformed, kJAStyle);
+    std::vector<FontCollection::Run> runs;
+    collection->itemize(reinterpret_cast<const uint8_t*>(kMalformed), strlen(kMalformed),
+            kJAStyle, &runs);
+    ASSERT_FALSE(runs.empty());
+    EXPECT_EQ(0, runs[0].start);
+    EXPECT_EQ(static_cast<int>(strlen(kMalformed)), runs.back().end);
+    EXPECT_EQ(kJAFont, getFontPath(runs.back()));
+}
+
+TEST_F(FontCollectionItemizeTest, itemize_manyDistinctCharacters) {
+    MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
+    const FontStyle kJAStyle = FontStyle(FontStyle::registerLanguageList("ja_JP"));
+
+    // U+3042 and U+1F467, then more distinct ideographs than the family cache holds, then the
+    // same two characters again. They must still get their fonts after being evicted.
+    std::vector<uint16_t> text = {0x3042, 0xD83D, 0xDC67};
+    for (uint16_t ch = 0x4E00; ch < 0x4E00 + 4096; ch++) {
+        text.push_back(ch);
+    }
+    text.insert(text.end(), {0x3042, 0xD83D, 0xDC67});
+
+    std::vector<FontCollection::Run> runs;
+    collection->itemize(text.data(), text.size(), kJAStyle, &runs);
+    ASSERT_LE(4U, runs.size());
+    EXPECT_EQ(0, runs[0].start);
+    EXPECT_EQ(1, runs[0].end);
+    EXPECT_EQ(kJAFont, getFontPath(runs[0]));
+    EXPECT_EQ(1, runs[1].start);
+    EXPECT_EQ(3, runs[1].end);
+    EXPECT_EQ(kEmojiFont, getFontPath(runs[1]));
+
+    const FontCollection::Run& ja = runs[runs.size() - 2];
+    EXPECT_EQ(static_cast<int>(text.size()) - 3, ja.start);
+    EXPECT_EQ(static_cast<int>(text.size()) - 2, ja.end);
+    EXPECT_EQ(kJAFont, getFontPath(ja));
+    EXPECT_EQ(static_cast<int>(text.size()) - 2, runs.back().start);
+    EXPECT_EQ(static_cast<int>(text.size()), runs.back().end);
+    EXPECT_EQ(kEmojiFont, getFontPath(runs.back()));
+}
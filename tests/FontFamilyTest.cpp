@@ -30,13 +30,11 @@ typedef ICUTestBase FontLanguagesTest;
 typedef ICUTestBase FontLanguageTest;
 
 static const FontLanguages& createFontLanguages(const std::string& input) {
-    AutoMutex _l(gMinikinLock);
     uint32_t langId = FontLanguageListCache::getId(input);
     return FontLanguageListCache::getById(langId);
 }
 
 static FontLanguage createFontLanguage(const std::string& input) {
-    AutoMutex _l(gMinikinLock);
     uint32_t langId = FontLanguageListCache::getId(input);
     return FontLanguageListCache::getById(langId)[0];
 }
@@ -353,8 +351,6 @@ TEST_F(FontFamilyTest, hasVariationSelectorTest) {
     MinikinAutoUnref<FontFamily> family(new FontFamily);
     family->addFont(minikinFont.get());
 
-    AutoMutex _l(gMinikinLock);
-
     const uint32_t kVS1 = 0xFE00;
     const uint32_t kVS2 = 0xFE01;
     const uint32_t kVS3 = 0xFE02;
@@ -405,7 +401,6 @@ TEST_F(FontFamilyTest, hasVSTableTest) {
         MinikinAutoUnref<MinikinFontForTest> minikinFont(new MinikinFontForTest(testCase.fontPath));
         MinikinAutoUnref<FontFamily> family(new FontFamily);
         family->addFont(minikinFont.get());
-        AutoMutex _l(gMinikinLock);
         family->getCoverage();
 
         EXPECT_EQ(testCase.hasVSTable, family->hasVSTable());
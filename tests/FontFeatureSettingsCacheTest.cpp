@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <hb.h>
+
+#include "FontFeatureSettingsCache.h"
+
+namespace android {
+
+TEST(FontFeatureSettingsCacheTest, getId) {
+    EXPECT_EQ(0UL, FontFeatureSettingsCache::getId(""));
+    EXPECT_NE(0UL, FontFeatureSettingsCache::getId("tnum"));
+
+    EXPECT_EQ(FontFeatureSettingsCache::getId("tnum"), FontFeatureSettingsCache::getId("tnum"));
+    EXPECT_NE(FontFeatureSettingsCache::getId("tnum"), FontFeatureSettingsCache::getId("smcp"));
+    EXPECT_NE(FontFeatureSettingsCache::getId("tnum,smcp"),
+              FontFeatureSettingsCache::getId("tnum"));
+
+    // Settings without any valid feature are the same as no settings.
+    EXPECT_EQ(0UL, FontFeatureSettingsCache::getId(","));
+}
+
+TEST(FontFeatureSettingsCacheTest, getById) {
+    EXPECT_TRUE(FontFeatureSettingsCache::getById(0).empty());
+
+    const FontFeatureSettings& features =
+            FontFeatureSettingsCache::getById(FontFeatureSettingsCache::getId("tnum,-liga"));
+    ASSERT_EQ(2UL, features.size());
+    EXPECT_EQ(HB_TAG('t', 'n', 'u', 'm'), features[0].tag);
+    EXPECT_EQ(1u, features[0].value);
+    EXPECT_EQ(HB_TAG('l', 'i', 'g', 'a'), features[1].tag);
+    EXPECT_EQ(0u, features[1].value);
+}
+
+TEST(FontFeatureSettingsCacheTest, invalidSettingsAreNotInterned) {
+    EXPECT_EQ(0UL, FontFeatureSettingsCache::getId("not a feature"));
+    EXPECT_EQ(0UL, FontFeatureSettingsCache::getId("not a feature"));
+}
+
+TEST(FontFeatureSettingsCacheTest, tooManySettings) {
+    const uint32_t tnumId = FontFeatureSettingsCache::getId("tnum");
+    ASSERT_NE(FontFeatureSettingsCache::kUncachedSettingsId, tnumId);
+
+    // Once the table is full, new settings are still usable but are not interned.
+    uint32_t lastId = 0;
+    for (int i = 0; i < 5000; i++) {
+        lastId = FontFeatureSettingsCache::getId("tnum=" + std::to_string(i + 2));
+    }
+    EXPECT_EQ(FontFeatureSettingsCache::kUncachedSettingsId, lastId);
+
+    FontFeatureSettings features;
+    FontFeatureSettingsCache::parse("tnum=5001", &features);
+    ASSERT_EQ(1UL, features.size());
+    EXPECT_EQ(5001u, features[0].value);
+
+    // Settings interned before the table filled up keep their IDs.
+    EXPECT_EQ(tnumId, FontFeatureSettingsCache::getId("tnum"));
+}
+
+}  // namespace android
@@ -16,11 +16,14 @@
 
 #include <gtest/gtest.h>
 
+#include <string>
+#include <thread>
+#include <vector>
+
 #include <minikin/FontFamily.h>
 
 #include "FontLanguageListCache.h"
 #include "ICUTestBase.h"
-#include "MinikinInternal.h"
 
 namespace android {
 
@@ -31,7 +34,6 @@ TEST_F(FontLanguageListCacheTest, getId) {
     EXPECT_NE(0UL, FontStyle::registerLanguageList("jp"));
     EXPECT_NE(0UL, FontStyle::registerLanguageList("en,zh-Hans"));
 
-    AutoMutex _l(gMinikinLock);
     EXPECT_EQ(0UL, FontLanguageListCache::getId(""));
 
     EXPECT_EQ(FontLanguageListCache::getId("en"), FontLanguageListCache::getId("en"));
@@ -50,7 +52,6 @@ TEST_F(FontLanguageListCacheTest, getId) {
 }
 
 TEST_F(FontLanguageListCacheTest, getById) {
-    AutoMutex _l(gMinikinLock);
     uint32_t enLangId = FontLanguageListCache::getId("en");
     uint32_t jpLangId = FontLanguageListCache::getId("jp");
     FontLanguage english = FontLanguageListCache::getById(enLangId)[0];
@@ -70,4 +71,32 @@ TEST_F(FontLanguageListCacheTest, getById) {
     EXPECT_EQ(japanese, langs2[1]);
 }
 
+TEST_F(FontLanguageListCacheTest, getIdFromMultipleThreads) {
+    const std::vector<std::string> langs = { "en", "jp", "en,zh-Hans", "ko,ja", "de-DE,fr" };
+    const size_t kThreadCount = 8;
+    std::vector<std::vector<uint32_t>> ids(kThreadCount);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < kThreadCount; ++t) {
+        threads.emplace_back([&langs, &ids, t]() {
+            for (size_t i = 0; i < langs.size(); ++i) {
+                // Start each thread at a different list so that they race on insertion.
+                const std::string& lang = langs[(i + t) % langs.size()];
+                const uint32_t id = FontLanguageListCache::getId(lang);
+                FontLanguageListCache::getById(id);
+                ids[t].push_back(id);
+            }
+        });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // Every thread must have observed the same ID for the same language list.
+    for (size_t t = 0; t < kThreadCount; ++t) {
+        for (size_t i = 0; i < langs.size(); ++i) {
+            EXPECT_EQ(FontLanguageListCache::getId(langs[(i + t) % langs.size()]), ids[t][i]);
+        }
+    }
+}
+
 }  // android
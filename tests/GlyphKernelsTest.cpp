@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "GlyphKernels.h"
+
+namespace android {
+
+TEST(GlyphKernelsTest, offsetPositionsTest) {
+    // Cover the vector loop and the scalar tail.
+    for (size_t n = 0; n < 11; n++) {
+        float src[11];
+        float dst[11];
+        for (size_t i = 0; i < n; i++) {
+            src[i] = i * 1.5f;
+        }
+        offsetPositions(dst, src, 10.0f, n);
+        for (size_t i = 0; i < n; i++) {
+            EXPECT_EQ(src[i] + 10.0f, dst[i]);
+        }
+        // In place.
+        offsetPositions(src, src, -1.0f, n);
+        for (size_t i = 0; i < n; i++) {
+            EXPECT_EQ(i * 1.5f - 1.0f, src[i]);
+        }
+    }
+}
+
+TEST(GlyphKernelsTest, joinRectsTest) {
+    const float lefts[] = { 0.0f, 1.0f, -3.0f, 2.0f, 5.0f, 4.0f, 6.0f };
+    const float tops[] = { -5.0f, -6.0f, -4.0f, -1.0f, -9.0f, -2.0f, -3.0f };
+    const float rights[] = { 1.0f, 2.0f, 3.0f, 4.0f, 6.0f, 9.0f, 8.0f };
+    const float bottoms[] = { 1.0f, 0.0f, 2.0f, 0.5f, 1.0f, 0.0f, 3.0f };
+    for (size_t n = 1; n <= 7; n++) {
+        MinikinRect rect;
+        rect.setEmpty();
+        joinRects(lefts, tops, rights, bottoms, n, &rect);
+        MinikinRect expected;
+        expected.setEmpty();
+        for (size_t i = 0; i < n; i++) {
+            MinikinRect r;
+            r.mLeft = lefts[i];
+            r.mTop = tops[i];
+            r.mRight = rights[i];
+            r.mBottom = bottoms[i];
+            expected.join(r);
+        }
+        EXPECT_EQ(expected.mLeft, rect.mLeft);
+        EXPECT_EQ(expected.mTop, rect.mTop);
+        EXPECT_EQ(expected.mRight, rect.mRight);
+        EXPECT_EQ(expected.mBottom, rect.mBottom);
+    }
+
+    // Joining nothing leaves the rect unchanged.
+    MinikinRect rect;
+    rect.setEmpty();
+    joinRects(lefts, tops, rights, bottoms, 0, &rect);
+    EXPECT_TRUE(rect.isEmpty());
+}
+
+}  // namespace android
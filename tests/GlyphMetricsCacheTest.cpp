@@ -0,0 +1,129 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "GlyphMetricsCache.h"
+#include "HbFontCache.h"
+
+namespace android {
+namespace {
+
+// A font whose advance is glyph id * size, counting calls into the backend.
+class CountingFont : public MinikinFont {
+public:
+    explicit CountingFont(int32_t uniqueId)
+            : MinikinFont(uniqueId), advanceCalls(0), boundsCalls(0) {}
+
+    float GetHorizontalAdvance(uint32_t glyph_id, const MinikinPaint& paint) const {
+        advanceCalls++;
+        return glyph_id * paint.size;
+    }
+
+    void GetBounds(MinikinRect* bounds, uint32_t glyph_id, const MinikinPaint& paint) const {
+        boundsCalls++;
+        bounds->mLeft = 0;
+        bounds->mTop = -paint.size;
+        bounds->mRight = glyph_id * paint.size;
+        bounds->mBottom = 0;
+    }
+
+    const void* GetTable(uint32_t, size_t* size, MinikinDestroyFunc*) {
+        *size = 0;
+        return nullptr;
+    }
+
+    mutable int advanceCalls;
+    mutable int boundsCalls;
+};
+
+TEST(GlyphMetricsCacheTest, advanceIsCached) {
+    CountingFont font(1);
+    MinikinPaint paint;
+    paint.font = &font;
+    paint.size = 10;
+    GlyphMetricsCache cache;
+
+    EXPECT_EQ(30.0f, cache.getHorizontalAdvance(3, paint));
+    EXPECT_EQ(30.0f, cache.getHorizontalAdvance(3, paint));
+    EXPECT_EQ(1, font.advanceCalls);
+
+    // A different size is a different entry.
+    paint.size = 20;
+    EXPECT_EQ(60.0f, cache.getHorizontalAdvance(3, paint));
+    EXPECT_EQ(2, font.advanceCalls);
+
+    // So is fake bold.
+    paint.fakery = FontFakery(true, false);
+    cache.getHorizontalAdvance(3, paint);
+    EXPECT_EQ(3, font.advanceCalls);
+}
+
+TEST(GlyphMetricsCacheTest, boundsAreCached) {
+    CountingFont font(2);
+    MinikinPaint paint;
+    paint.font = &font;
+    paint.size = 10;
+    GlyphMetricsCache cache;
+
+    MinikinRect bounds;
+    cache.getBounds(&bounds, 4, paint);
+    EXPECT_EQ(40.0f, bounds.mRight);
+    cache.getBounds(&bounds, 4, paint);
+    EXPECT_EQ(40.0f, bounds.mRight);
+    EXPECT_EQ(1, font.boundsCalls);
+
+    // Advances of the same glyph are fetched separately.
+    cache.getHorizontalAdvance(4, paint);
+    EXPECT_EQ(1, font.advanceCalls);
+}
+
+TEST(GlyphMetricsCacheTest, purgeFlushesCache) {
+    CountingFont font(3);
+    MinikinPaint paint;
+    paint.font = &font;
+    paint.size = 10;
+    GlyphMetricsCache cache;
+
+    cache.getHorizontalAdvance(5, paint);
+    purgeHbFontCache();
+    cache.getHorizontalAdvance(5, paint);
+    EXPECT_EQ(2, font.advanceCalls);
+}
+
+TEST(GlyphMetricsCacheTest, purgingFontKeepsOtherFonts) {
+    CountingFont fontA(4);
+    CountingFont fontB(5);
+    MinikinPaint paint;
+    paint.size = 10;
+    GlyphMetricsCache cache;
+
+    paint.font = &fontA;
+    cache.getHorizontalAdvance(5, paint);
+    paint.font = &fontB;
+    cache.getHorizontalAdvance(5, paint);
+
+    purgeHbFont(&fontA);
+    paint.font = &fontA;
+    cache.getHorizontalAdvance(5, paint);
+    EXPECT_EQ(2, fontA.advanceCalls);
+    paint.font = &fontB;
+    cache.getHorizontalAdvance(5, paint);
+    EXPECT_EQ(1, fontB.advanceCalls);
+}
+
+}  // namespace
+}  // namespace android
@@ -18,12 +18,11 @@
 
 #include <android/log.h>
 #include <gtest/gtest.h>
-#include <utils/Mutex.h>
 
 #include <hb.h>
 
-#include "MinikinInternal.h"
 #include "MinikinFontForTest.h"
+#include <minikin/Layout.h>
 #include <minikin/MinikinFont.h>
 
 namespace android {
@@ -32,40 +31,36 @@ namespace {
 class HbFontCacheTest : public testing::Test {
 public:
     virtual void TearDown() {
-        AutoMutex _l(gMinikinLock);
-        purgeHbFontCacheLocked();
+        purgeHbFontCache();
     }
 };
 
-TEST_F(HbFontCacheTest, getHbFontLockedTest) {
-    AutoMutex _l(gMinikinLock);
-
+TEST_F(HbFontCacheTest, getHbFontTest) {
     MinikinFontForTest fontA(kTestFontDir "Regular.ttf");
     MinikinFontForTest fontB(kTestFontDir "Bold.ttf");
     MinikinFontForTest fontC(kTestFontDir "BoldItalic.ttf");
 
     // Never return NULL.
-    EXPECT_NE(nullptr, getHbFontLocked(&fontA));
-    EXPECT_NE(nullptr, getHbFontLocked(&fontB));
-    EXPECT_NE(nullptr, getHbFontLocked(&fontC));
+    EXPECT_NE(nullptr, getHbFont(&fontA));
+    EXPECT_NE(nullptr, getHbFont(&fontB));
+    EXPECT_NE(nullptr, getHbFont(&fontC));
 
-    EXPECT_NE(nullptr, getHbFontLocked(nullptr));
+    EXPECT_NE(nullptr, getHbFont(nullptr));
 
     // Must return same object if same font object is passed.
-    EXPECT_EQ(getHbFontLocked(&fontA), getHbFontLocked(&fontA));
-    EXPECT_EQ(getHbFontLocked(&fontB), getHbFontLocked(&fontB));
-    EXPECT_EQ(getHbFontLocked(&fontC), getHbFontLocked(&fontC));
+    EXPECT_EQ(getHbFont(&fontA), getHbFont(&fontA));
+    EXPECT_EQ(getHbFont(&fontB), getHbFont(&fontB));
+    EXPECT_EQ(getHbFont(&fontC), getHbFont(&fontC));
 
     // Different object must be returned if the passed minikinFont has different ID.
-    EXPECT_NE(getHbFontLocked(&fontA), getHbFontLocked(&fontB));
-    EXPECT_NE(getHbFontLocked(&fontA), getHbFontLocked(&fontC));
+    EXPECT_NE(getHbFont(&fontA), getHbFont(&fontB));
+    EXPECT_NE(getHbFont(&fontA), getHbFont(&fontC));
 }
 
 TEST_F(HbFontCacheTest, purgeCacheTest) {
-    AutoMutex _l(gMinikinLock);
     MinikinFontForTest minikinFont(kTestFontDir "Regular.ttf");
 
-    hb_font_t* font = getHbFontLocked(&minikinFont);
+    hb_font_t* font = getHbFont(&minikinFont);
     ASSERT_NE(nullptr, font);
 
     // Set user data to identify the font object.
@@ -74,14 +69,39 @@ TEST_F(HbFontCacheTest, purgeCacheTest) {
     hb_font_set_user_data(font, &key, data, NULL, false);
     ASSERT_EQ(data, hb_font_get_user_data(font, &key));
 
-    purgeHbFontCacheLocked();
+    purgeHbFontCache();
 
     // By checking user data, confirm that the object after purge is different from previously
     // created one. Do not compare the returned pointer here since memory allocator may assign
     // same region for new object.
-    font = getHbFontLocked(&minikinFont);
+    font = getHbFont(&minikinFont);
     EXPECT_EQ(nullptr, hb_font_get_user_data(font, &key));
 }
 
+TEST_F(HbFontCacheTest, statsTest) {
+    MinikinFontForTest fontA(kTestFontDir "Regular.ttf");
+    MinikinFontForTest fontB(kTestFontDir "Bold.ttf");
+    resetHbFontCacheStats();
+
+    hb_font_destroy(getHbFont(&fontA));
+    hb_font_destroy(getHbFont(&fontA));
+    hb_font_destroy(getHbFont(&fontB));
+
+    CacheStats stats;
+    getHbFontCacheStats(&stats);
+    EXPECT_EQ(1u, stats.hits);
+    EXPECT_EQ(2u, stats.misses);
+    EXPECT_EQ(0u, stats.evictions);
+    EXPECT_EQ(2u, stats.entries);
+
+    resetHbFontCacheStats();
+    getHbFontCacheStats(&stats);
+    EXPECT_EQ(0u, stats.hits);
+    EXPECT_EQ(0u, stats.misses);
+    EXPECT_EQ(0u, stats.missNanos);
+    // Resetting the counters does not drop entries.
+    EXPECT_EQ(2u, stats.entries);
+}
+
 }  // namespace
 }  // namespace android
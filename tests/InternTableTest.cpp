@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "InternTable.h"
+
+namespace android {
+
+TEST(InternTableTest, insertAndFind) {
+    InternTable<std::string> table(UINT32_MAX);
+    const uint32_t kNotInterned = InternTable<std::string>::kNotInterned;
+
+    EXPECT_EQ(kNotInterned, table.find("a"));
+    const uint32_t id = table.insert("a", std::string("A"));
+    EXPECT_EQ(0u, id);
+    EXPECT_EQ(id, table.find("a"));
+    EXPECT_EQ("A", table.getById(id));
+
+    // Inserting the same string again keeps the first value.
+    EXPECT_EQ(id, table.insert("a", std::string("other")));
+    EXPECT_EQ("A", table.getById(id));
+}
+
+TEST(InternTableTest, growsPastManyChunks) {
+    InternTable<std::string> table(UINT32_MAX);
+    const uint32_t kCount = 100000;
+    for (uint32_t i = 0; i < kCount; i++) {
+        ASSERT_EQ(i, table.insert(std::to_string(i), std::to_string(i * 2)));
+    }
+    for (uint32_t i = 0; i < kCount; i += 997) {
+        EXPECT_EQ(i, table.find(std::to_string(i)));
+        EXPECT_EQ(std::to_string(i * 2), table.getById(i));
+    }
+}
+
+TEST(InternTableTest, maxSize) {
+    InternTable<int> table(2);
+    const uint32_t kNotInterned = InternTable<int>::kNotInterned;
+
+    EXPECT_EQ(0u, table.insert("a", 1));
+    EXPECT_EQ(1u, table.insert("b", 2));
+    EXPECT_EQ(kNotInterned, table.insert("c", 3));
+    EXPECT_EQ(kNotInterned, table.find("c"));
+    EXPECT_EQ(2, table.getById(1));
+}
+
+}  // namespace android
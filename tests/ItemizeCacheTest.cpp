@@ -0,0 +1,120 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "ItemizeCache.h"
+
+#include <gtest/gtest.h>
+
+#include "FontTestUtils.h"
+#include "ICUTestBase.h"
+#include "MinikinFontForTest.h"
+#include "UnicodeUtils.h"
+
+namespace android {
+namespace {
+
+const char kItemizeFontXml[] = kTestFontDir "itemize.xml";
+
+class ItemizeCacheTest : public ICUTestBase {
+public:
+    virtual void TearDown() {
+        setItemizeCacheMaxBytes(0);
+        purgeItemizeCache();
+        ICUTestBase::TearDown();
+    }
+};
+
+void expectSameRuns(const std::vector<FontCollection::Run>& expected,
+        const std::vector<FontCollection::Run>& actual) {
+    ASSERT_EQ(expected.size(), actual.size());
+    for (size_t i = 0; i < expected.size(); i++) {
+        EXPECT_EQ(expected[i].start, actual[i].start);
+        EXPECT_EQ(expected[i].end, actual[i].end);
+        EXPECT_EQ(expected[i].fakedFont.font, actual[i].fakedFont.font);
+    }
+}
+
+TEST_F(ItemizeCacheTest, sameRunsAsItemize) {
+    MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
+    const FontStyle style(FontStyle::registerLanguageList("en_US"));
+    const size_t BUF_SIZE = 256;
+    uint16_t buf[BUF_SIZE];
+    size_t len;
+    ParseUnicode(buf, BUF_SIZE, "'a' U+4F60 'b' U+4F60 'c'", &len, NULL);
+
+    std::vector<FontCollection::Run> expected;
+    collection->itemize(buf, len, style, &expected);
+
+    setItemizeCacheMaxBytes(64 * 1024);
+    for (int i = 0; i < 2; i++) {
+        // The first call fills the cache, the second one is served from it.
+        std::vector<FontCollection::Run> runs;
+        itemizeCached(collection.get(), buf, len, style, &runs);
+        expectSameRuns(expected, runs);
+    }
+
+    // A different collection must not get the runs of the first one.
+    MinikinAutoUnref<FontCollection> other(getFontCollection(kTestFontDir, kItemizeFontXml));
+    std::vector<FontCollection::Run> runs;
+    itemizeCached(other.get(), buf, len, style, &runs);
+    ASSERT_EQ(expected.size(), runs.size());
+    EXPECT_NE(expected[0].fakedFont.font, runs[0].fakedFont.font);
+}
+
+TEST_F(ItemizeCacheTest, collectionLifetime) {
+    const FontStyle style;
+    const uint16_t text[] = { 'a', 0x3042, 'b' };
+    setItemizeCacheMaxBytes(64 * 1024);
+
+    {
+        MinikinAutoUnref<FontCollection> collection(
+                getFontCollection(kTestFontDir, kItemizeFontXml));
+        std::vector<FontCollection::Run> runs;
+        itemizeCached(collection.get(), text, 3, style, &runs);
+    }
+
+    // The entries of the destroyed collection are still cached, but a new collection never
+    // gets them, even if it is allocated at the same address.
+    MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
+    std::vector<FontCollection::Run> expected;
+    collection->itemize(text, 3, style, &expected);
+    std::vector<FontCollection::Run> runs;
+    itemizeCached(collection.get(), text, 3, style, &runs);
+    expectSameRuns(expected, runs);
+
+    // After a purge the runs are itemized again and cached anew.
+    purgeItemizeCache();
+    for (int i = 0; i < 2; i++) {
+        runs.clear();
+        itemizeCached(collection.get(), text, 3, style, &runs);
+        expectSameRuns(expected, runs);
+    }
+}
+
+TEST_F(ItemizeCacheTest, disabledByDefault) {
+    MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
+    const FontStyle style;
+    const uint16_t text[] = { 'a', 'b', 'c' };
+
+    std::vector<FontCollection::Run> expected;
+    collection->itemize(text, 3, style, &expected);
+    std::vector<FontCollection::Run> runs;
+    itemizeCached(collection.get(), text, 3, style, &runs);
+    expectSameRuns(expected, runs);
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,443 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <minikin/Layout.h>
+
+#include "FontTestUtils.h"
+#include "ICUTestBase.h"
+#include "UnicodeUtils.h"
+#include "Utf8Utils.h"
+
+namespace android {
+namespace {
+
+const char kItemizeFontXml[] = kTestFontDir "itemize.xml";
+
+class LayoutTest : public ICUTestBase {
+public:
+    LayoutTest() : mCollection(nullptr) {
+        mPaint.size = 10;
+        mPaint.scaleX = 1;
+    }
+
+protected:
+    virtual void SetUp() override {
+        ICUTestBase::SetUp();
+        mCollection = getFontCollection(kTestFontDir, kItemizeFontXml);
+    }
+
+    virtual void TearDown() override {
+        mCollection->Unref();
+        ICUTestBase::TearDown();
+    }
+
+    // Checks that two layouts of count characters have the same glyphs, font runs and advances.
+    void expectSameLayout(const Layout& expected, const Layout& actual, size_t count) {
+        ASSERT_EQ(expected.nGlyphs(), actual.nGlyphs());
+        for (size_t i = 0; i < expected.nGlyphs(); i++) {
+            EXPECT_EQ(expected.getGlyphId(i), actual.getGlyphId(i));
+            EXPECT_EQ(expected.getFont(i), actual.getFont(i));
+            EXPECT_EQ(expected.getX(i), actual.getX(i));
+            EXPECT_EQ(expected.getY(i), actual.getY(i));
+        }
+        ASSERT_EQ(expected.nFontRuns(), actual.nFontRuns());
+        for (size_t i = 0; i < expected.nFontRuns(); i++) {
+            EXPECT_EQ(expected.getFontRun(i).font, actual.getFontRun(i).font);
+            EXPECT_EQ(expected.getFontRun(i).start, actual.getFontRun(i).start);
+            EXPECT_EQ(expected.getFontRun(i).end, actual.getFontRun(i).end);
+        }
+        EXPECT_EQ(expected.getAdvance(), actual.getAdvance());
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(expected.getCharAdvance(i), actual.getCharAdvance(i));
+        }
+    }
+
+    // Lays out before, replaces oldLength characters at editStart with inserted, and checks
+    // that doLayoutAfterEdit gives the same result as laying out the new text from scratch.
+    void expectEditMatchesFullLayout(const char* before, size_t editStart, size_t oldLength,
+            const char* inserted) {
+        SCOPED_TRACE(before);
+        SCOPED_TRACE(inserted);
+        const size_t BUF_SIZE = 64;
+        uint16_t prevBuf[BUF_SIZE];
+        size_t prevSize;
+        ParseUnicode(prevBuf, BUF_SIZE, before, &prevSize, nullptr);
+        uint16_t insertedBuf[BUF_SIZE];
+        size_t newLength;
+        ParseUnicode(insertedBuf, BUF_SIZE, inserted, &newLength, nullptr);
+        ASSERT_LE(editStart + oldLength, prevSize);
+
+        std::vector<uint16_t> buf(prevBuf, prevBuf + editStart);
+        buf.insert(buf.end(), insertedBuf, insertedBuf + newLength);
+        buf.insert(buf.end(), prevBuf + editStart + oldLength, prevBuf + prevSize);
+        const size_t bufSize = buf.size();
+
+        Layout prev;
+        prev.setFontCollection(mCollection);
+        prev.doLayout(prevBuf, 0, prevSize, prevSize, kBidi_Default_LTR, mStyle, mPaint);
+
+        Layout edited;
+        edited.setFontCollection(mCollection);
+        edited.doLayoutAfterEdit(prev, editStart, oldLength, newLength, buf.data(), bufSize,
+                kBidi_Default_LTR, mStyle, mPaint);
+
+        Layout expected;
+        expected.setFontCollection(mCollection);
+        expected.doLayout(buf.data(), 0, bufSize, bufSize, kBidi_Default_LTR, mStyle, mPaint);
+
+        ASSERT_EQ(expected.nGlyphs(), edited.nGlyphs());
+        for (size_t i = 0; i < expected.nGlyphs(); i++) {
+            EXPECT_EQ(expected.getGlyphId(i), edited.getGlyphId(i));
+            EXPECT_EQ(expected.getFont(i), edited.getFont(i));
+            EXPECT_FLOAT_EQ(expected.getX(i), edited.getX(i));
+            EXPECT_EQ(expected.getY(i), edited.getY(i));
+        }
+        ASSERT_EQ(expected.nFontRuns(), edited.nFontRuns());
+        for (size_t i = 0; i < expected.nFontRuns(); i++) {
+            EXPECT_EQ(expected.getFontRun(i).font, edited.getFontRun(i).font);
+            EXPECT_EQ(expected.getFontRun(i).start, edited.getFontRun(i).start);
+            EXPECT_EQ(expected.getFontRun(i).end, edited.getFontRun(i).end);
+        }
+        EXPECT_EQ(expected.getAdvance(), edited.getAdvance());
+        for (size_t i = 0; i < bufSize; i++) {
+            EXPECT_EQ(expected.getCharAdvance(i), edited.getCharAdvance(i));
+        }
+    }
+
+    // Checks that doLayoutUtf8 and measureTextUtf8 of the bytes [start, start + count) give the
+    // results of the UTF-16 entry points on the transcoded text, with the advances moved to the
+    // first byte of each code point.
+    void expectUtf8RangeMatchesUtf16(const char* str, size_t start, size_t count,
+            int bidiFlags) {
+        SCOPED_TRACE(str);
+        SCOPED_TRACE(start);
+        SCOPED_TRACE(count);
+        const uint8_t* text = reinterpret_cast<const uint8_t*>(str);
+        const size_t length = strlen(str);
+        std::vector<uint16_t> utf16;
+        std::vector<uint32_t> utf16ToUtf8;
+        std::vector<uint32_t> utf8ToUtf16;
+        transcodeUtf8(text, length, &utf16, &utf16ToUtf8, &utf8ToUtf16);
+        const size_t utf16Length = utf16.size();
+        const size_t utf16Start = utf8ToUtf16[start];
+        const size_t utf16Count = utf8ToUtf16[start + count] - utf16Start;
+
+        Layout expected;
+        expected.setFontCollection(mCollection);
+        expected.doLayout(utf16.data(), utf16Start, utf16Count, utf16Length, bidiFlags, mStyle,
+                mPaint);
+        Layout layout;
+        layout.setFontCollection(mCollection);
+        layout.doLayoutUtf8(text, start, count, length, bidiFlags, mStyle, mPaint);
+
+        ASSERT_EQ(expected.nGlyphs(), layout.nGlyphs());
+        for (size_t i = 0; i < expected.nGlyphs(); i++) {
+            EXPECT_EQ(expected.getGlyphId(i), layout.getGlyphId(i));
+            EXPECT_EQ(expected.getFont(i), layout.getFont(i));
+            EXPECT_EQ(expected.getX(i), layout.getX(i));
+        }
+        EXPECT_EQ(expected.getAdvance(), layout.getAdvance());
+        std::vector<float> utf16Advances(utf16Count);
+        expected.getAdvances(utf16Advances.data());
+        std::vector<float> expectedAdvances(count);
+        utf16ToUtf8Advances(utf16ToUtf8, utf16Advances.data(), utf16Start, utf16Count,
+                expectedAdvances.data(), start, count);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(expectedAdvances[i], layout.getCharAdvance(i));
+        }
+
+        const float expectedWidth = Layout::measureText(utf16.data(), utf16Start, utf16Count,
+                utf16Length, bidiFlags, mStyle, mPaint, mCollection, utf16Advances.data());
+        std::vector<float> advances(count);
+        EXPECT_EQ(expectedWidth, Layout::measureTextUtf8(text, start, count, length, bidiFlags,
+                mStyle, mPaint, mCollection, advances.data()));
+        utf16ToUtf8Advances(utf16ToUtf8, utf16Advances.data(), utf16Start, utf16Count,
+                expectedAdvances.data(), start, count);
+        for (size_t i = 0; i < count; i++) {
+            EXPECT_EQ(expectedAdvances[i], advances[i]);
+        }
+    }
+
+    // Checks the whole string, and the string from its second code point on, so that the range
+    // does not start at 0.
+    void expectUtf8MatchesUtf16(const char* str) {
+        const uint8_t* text = reinterpret_cast<const uint8_t*>(str);
+        const size_t length = strlen(str);
+        expectUtf8RangeMatchesUtf16(str, 0, length, kBidi_Default_LTR);
+        size_t start = 0;
+        nextUtf8CodePoint(text, &start, length);
+        expectUtf8RangeMatchesUtf16(str, start, length - start, kBidi_Default_LTR);
+    }
+
+    FontCollection* mCollection;
+    FontStyle mStyle;
+    MinikinPaint mPaint;
+};
+
+TEST_F(LayoutTest, doLayoutAfterEdit) {
+    // Replace and insert words that use another font.
+    expectEditMatchesFullLayout("'a' U+0020 'b' U+0020 U+3042", 0, 1, "U+3042");
+    expectEditMatchesFullLayout("'a' U+0020 'b'", 1, 0, "U+0020 U+3042 'c'");
+    expectEditMatchesFullLayout("U+3042 U+0020 'b'", 0, 2, "");
+
+    // Insert and delete surrogate pairs.
+    expectEditMatchesFullLayout("'a' U+0020 'b'", 1, 0, "U+0020 U+242EE");
+    expectEditMatchesFullLayout("'a' U+242EE U+0020 'b'", 1, 2, "");
+    // Complete a pair whose lead surrogate is already in the text.
+    expectEditMatchesFullLayout("'a' U+0020 U+D850 U+0020 'b'", 3, 0, "U+DEEE");
+}
+
+TEST_F(LayoutTest, doLayoutAfterEditRtl) {
+    expectEditMatchesFullLayout("'a' U+0020 'b'", 1, 0, "U+05D0");
+    expectEditMatchesFullLayout("U+05D0 U+0020 'b'", 0, 1, "'a'");
+
+    // A lone lead surrogate is left to right, but completing it with a trail surrogate makes
+    // U+10800 CYPRIOT SYLLABLE A, which is right to left and turns the paragraph around.
+    expectEditMatchesFullLayout("U+D802 U+0020 'a' 'b' 'c'", 1, 0, "U+DC00");
+    // The same, by deleting the character between the two halves.
+    expectEditMatchesFullLayout("U+D802 'a' U+DC00 U+0020 'b' 'c'", 1, 1, "");
+}
+
+// Builds paragraphs of Latin, Japanese, emoji and Hebrew words separated by newlines, long enough
+// for parallel layout.
+std::vector<uint16_t> makeMultiParagraphText() {
+    const uint16_t kParagraph[] = {'a', 'b', ' ', 'c', 'd', 'e', ',', ' ', 0x3042, 0x3042, ' ',
+            0xD83D, 0xDC67, ' ', 0x05D0, 0x05D1, ' ', 'a', 0x0301, '!', '\n'};
+    const size_t kParagraphLength = sizeof(kParagraph) / sizeof(kParagraph[0]);
+    std::vector<uint16_t> text;
+    while (text.size() < 4096) {
+        text.insert(text.end(), kParagraph, kParagraph + kParagraphLength);
+    }
+    return text;
+}
+
+TEST_F(LayoutTest, parallelLayoutMatchesSerial) {
+    const std::vector<uint16_t> text = makeMultiParagraphText();
+    const size_t size = text.size();
+
+    Layout::setLayoutThreadCount(0);
+    Layout::purgeCaches();
+    Layout serial;
+    serial.setFontCollection(mCollection);
+    serial.doLayout(text.data(), 0, size, size, kBidi_Default_LTR, mStyle, mPaint);
+
+    // Shape everything again on the workers rather than copying from the layout cache.
+    Layout::setLayoutThreadCount(4);
+    Layout::purgeCaches();
+    Layout parallel;
+    parallel.setFontCollection(mCollection);
+    parallel.doLayout(text.data(), 0, size, size, kBidi_Default_LTR, mStyle, mPaint);
+    Layout::setLayoutThreadCount(0);
+
+    expectSameLayout(serial, parallel, size);
+}
+
+TEST_F(LayoutTest, measureTextBatchMatchesMeasureText) {
+    const std::vector<uint16_t> text = makeMultiParagraphText();
+    MinikinPaint largePaint = mPaint;
+    largePaint.size = 20;
+    const int kBidiFlags[] = {kBidi_Default_LTR, kBidi_RTL, kBidi_Force_LTR};
+
+    // More items than one chunk, so that the batch is split over the workers when they exist.
+    const size_t kItemCount = 100;
+    std::vector<std::vector<float>> advances(kItemCount);
+    std::vector<MeasureTextItem> items(kItemCount);
+    for (size_t i = 0; i < kItemCount; i++) {
+        MeasureTextItem& item = items[i];
+        item.buf = text.data();
+        item.start = (i * 37) % 1000;
+        item.count = 1 + (i * 13) % 50;
+        item.bufSize = text.size();
+        item.bidiFlags = kBidiFlags[i % 3];
+        item.style = &mStyle;
+        item.paint = i % 2 ? &largePaint : &mPaint;
+        item.collection = mCollection;
+        advances[i].resize(item.count);
+        // Some callers only want the total.
+        item.advances = i % 4 == 3 ? nullptr : advances[i].data();
+    }
+
+    const size_t kThreadCounts[] = {0, 4};
+    for (size_t threadCount : kThreadCounts) {
+        SCOPED_TRACE(threadCount);
+        Layout::setLayoutThreadCount(threadCount);
+        for (MeasureTextItem& item : items) {
+            item.totalAdvance = -1;
+        }
+        Layout::measureTextBatch(items.data(), items.size());
+        for (size_t i = 0; i < kItemCount; i++) {
+            SCOPED_TRACE(i);
+            const MeasureTextItem& item = items[i];
+            std::vector<float> expectedAdvances(item.count);
+            EXPECT_EQ(Layout::measureText(item.buf, item.start, item.count, item.bufSize,
+                    item.bidiFlags, *item.style, *item.paint, item.collection,
+                    expectedAdvances.data()), item.totalAdvance);
+            if (item.advances != nullptr) {
+                EXPECT_EQ(expectedAdvances, advances[i]);
+            }
+        }
+    }
+    Layout::setLayoutThreadCount(0);
+}
+
+TEST_F(LayoutTest, glyphOutputBuffers) {
+    const size_t BUF_SIZE = 64;
+    uint16_t buf[BUF_SIZE];
+    size_t size;
+    ParseUnicode(buf, BUF_SIZE, "'a' 'b' U+3042 U+0020 'c' U+1F467 U+0020 'd' 'e'", &size,
+            nullptr);
+    Layout expected;
+    expected.setFontCollection(mCollection);
+    expected.doLayout(buf, 0, size, size, kBidi_Default_LTR, mStyle, mPaint);
+    const size_t glyphCount = expected.nGlyphs();
+    ASSERT_LT(2u, glyphCount);
+
+    // Too small: the counts report what is needed and the glyphs that fit are written.
+    std::vector<uint32_t> glyphIds(glyphCount);
+    std::vector<float> xs(glyphCount);
+    std::vector<uint32_t> fontIndices(glyphCount);
+    std::vector<FakedFont> faces(1);
+    GlyphOutputBuffers output = {glyphIds.data(), xs.data(), nullptr, fontIndices.data(), 2,
+            faces.data(), faces.size(), 0, 0};
+    Layout layout;
+    layout.setFontCollection(mCollection);
+    EXPECT_FALSE(layout.doLayout(buf, 0, size, size, kBidi_Default_LTR, mStyle, mPaint,
+            &output));
+    EXPECT_EQ(glyphCount, output.glyphCount);
+    ASSERT_LT(1u, output.faceCount);
+    EXPECT_EQ(0u, layout.nGlyphs());
+    EXPECT_EQ(expected.getAdvance(), layout.getAdvance());
+    for (size_t i = 0; i < 2; i++) {
+        EXPECT_EQ(expected.getGlyphId(i), glyphIds[i]);
+        EXPECT_EQ(expected.getX(i), xs[i]);
+    }
+
+    // Retry with the reported sizes.
+    std::vector<float> ys(glyphCount);
+    faces.resize(output.faceCount);
+    output = {glyphIds.data(), xs.data(), ys.data(), fontIndices.data(), glyphCount,
+            faces.data(), faces.size(), 0, 0};
+    EXPECT_TRUE(layout.doLayout(buf, 0, size, size, kBidi_Default_LTR, mStyle, mPaint,
+            &output));
+    ASSERT_EQ(glyphCount, output.glyphCount);
+    ASSERT_EQ(faces.size(), output.faceCount);
+    for (size_t i = 0; i < glyphCount; i++) {
+        EXPECT_EQ(expected.getGlyphId(i), glyphIds[i]);
+        EXPECT_EQ(expected.getX(i), xs[i]);
+        EXPECT_EQ(expected.getY(i), ys[i]);
+        ASSERT_LT(fontIndices[i], faces.size());
+        EXPECT_EQ(expected.getFont(i), faces[fontIndices[i]].font);
+    }
+    EXPECT_EQ(expected.getAdvance(), layout.getAdvance());
+    for (size_t i = 0; i < size; i++) {
+        EXPECT_EQ(expected.getCharAdvance(i), layout.getCharAdvance(i));
+    }
+}
+
+TEST_F(LayoutTest, bidiParagraphMatchesDoLayout) {
+    const size_t BUF_SIZE = 64;
+    uint16_t buf[BUF_SIZE];
+    size_t size;
+    // Mixed direction text, with a right to left run that spans the break between the lines.
+    ParseUnicode(buf, BUF_SIZE, "'a' 'b' U+0020 U+05D0 U+05D1 U+0020 U+05D2 U+0020 'c' 'd' "
+            "U+0020 U+3042 U+0020 U+05D3 'e'", &size, nullptr);
+    const size_t kLineBreaks[] = {0, 5, 10, size};
+    const int kBidiFlags[] = {kBidi_Default_LTR, kBidi_Default_RTL, kBidi_LTR, kBidi_RTL};
+    for (int bidiFlags : kBidiFlags) {
+        SCOPED_TRACE(bidiFlags);
+        BidiParagraph paragraph;
+        paragraph.setParagraph(buf, size, bidiFlags);
+        for (size_t line = 0; line + 1 < sizeof(kLineBreaks) / sizeof(kLineBreaks[0]); line++) {
+            const size_t start = kLineBreaks[line];
+            const size_t count = kLineBreaks[line + 1] - start;
+            SCOPED_TRACE(start);
+
+            Layout expected;
+            expected.setFontCollection(mCollection);
+            expected.doLayout(buf, start, count, size, bidiFlags, mStyle, mPaint);
+            Layout layout;
+            layout.setFontCollection(mCollection);
+            layout.doLayout(paragraph, start, count, mStyle, mPaint);
+            expectSameLayout(expected, layout, count);
+
+            std::vector<float> expectedAdvances(count);
+            std::vector<float> advances(count);
+            EXPECT_EQ(Layout::measureText(buf, start, count, size, bidiFlags, mStyle, mPaint,
+                    mCollection, expectedAdvances.data()),
+                    Layout::measureText(paragraph, start, count, mStyle, mPaint, mCollection,
+                            advances.data()));
+            EXPECT_EQ(expectedAdvances, advances);
+        }
+    }
+}
+
+TEST_F(LayoutTest, getFontInAnyOrder) {
+    // Alternate between the Regular, Ja and Emoji fonts.
+    const size_t BUF_SIZE = 64;
+    uint16_t buf[BUF_SIZE];
+    size_t size;
+    ParseUnicode(buf, BUF_SIZE, "'a' 'b' U+3042 'c' U+1F467 U+3042 U+3042 'd' U+1F469 'e'", &size,
+            nullptr);
+    Layout layout;
+    layout.setFontCollection(mCollection);
+    layout.doLayout(buf, 0, size, size, kBidi_LTR, mStyle, mPaint);
+    ASSERT_LT(2u, layout.nFontRuns());
+
+    std::vector<MinikinFont*> fonts(layout.nGlyphs());
+    for (size_t run = 0; run < layout.nFontRuns(); run++) {
+        const LayoutFontRun fontRun = layout.getFontRun(run);
+        std::fill(fonts.begin() + fontRun.start, fonts.begin() + fontRun.end, fontRun.font);
+    }
+    // Forwards, backwards and jumping around.
+    for (size_t i = 0; i < fonts.size(); i++) {
+        EXPECT_EQ(fonts[i], layout.getFont(i));
+    }
+    for (size_t i = fonts.size(); i > 0; i--) {
+        EXPECT_EQ(fonts[i - 1], layout.getFont(i - 1));
+    }
+    for (size_t i = 0; i < fonts.size(); i++) {
+        const size_t glyph = (i * 7) % fonts.size();
+        EXPECT_EQ(fonts[glyph], layout.getFont(glyph));
+    }
+}
+
+TEST_F(LayoutTest, utf8MatchesUtf16) {
+    // 'a' U+0301, U+3042 and U+242EE, which takes four bytes and a surrogate pair.
+    expectUtf8MatchesUtf16("\x61\xCC\x81\x20\xE3\x81\x82\xF0\xA4\x8B\xAE\x20\x62");
+    // Starts with a four byte character.
+    expectUtf8MatchesUtf16("\xF0\xA4\x8B\xAE\xE3\x81\x82\x20\x61\x62");
+    // Right to left text is reordered the same way.
+    expectUtf8MatchesUtf16("\xD7\x90\xD7\x91\x20\x61\x62\x63\x20\xE3\x81\x82");
+    // A lone continuation byte, a truncated sequence and an encoded surrogate decode to U+FFFD,
+    // as they do when converted to UTF-16.
+    expectUtf8MatchesUtf16("\x61\x80\x62\xE3\x81\x20\xED\xA0\x80\xE3\x81\x82");
+
+    // Ranges in the middle of the text, where only the words around them are converted.
+    // "ab " U+3042 "cd" U+242EE " e" with a range inside the word "cd" U+242EE.
+    const char kText[] = "\x61\x62\x20\xE3\x81\x82\x63\x64\xF0\xA4\x8B\xAE\x20\x65";
+    expectUtf8RangeMatchesUtf16(kText, 7, 5, kBidi_Default_LTR);
+    expectUtf8RangeMatchesUtf16(kText, 3, 10, kBidi_LTR);
+    expectUtf8RangeMatchesUtf16(kText, 7, 5, kBidi_Force_LTR);
+    expectUtf8RangeMatchesUtf16(kText, 1, 6, kBidi_Force_RTL);
+    // With right to left text after the range, the whole paragraph is converted.
+    const char kRtlText[] = "\x61\x62\x20\x63\x20\xD7\x90\xD7\x91";
+    expectUtf8RangeMatchesUtf16(kRtlText, 1, 3, kBidi_Default_LTR);
+}
+
+}  // namespace
+}  // namespace android
@@ -0,0 +1,107 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <minikin/LineBreaker.h>
+
+#include "FontTestUtils.h"
+#include "ICUTestBase.h"
+#include "Utf8Utils.h"
+
+namespace android {
+namespace {
+
+const char kItemizeFontXml[] = kTestFontDir "itemize.xml";
+
+typedef ICUTestBase LineBreakerTest;
+
+// Breaks text set with setTextUtf8 and the same text set as UTF-16, with two style runs split at
+// utf8Split and a replacement for the code point at utf8Replacement, and checks that the breaks
+// and widths are the same once mapped to bytes.
+void expectUtf8BreaksMatchUtf16(const FontCollection* collection, const char* str,
+        size_t utf8Split, size_t utf8Replacement) {
+    SCOPED_TRACE(str);
+    const uint8_t* text = reinterpret_cast<const uint8_t*>(str);
+    const size_t length = strlen(str);
+    std::vector<uint16_t> utf16;
+    std::vector<uint32_t> utf16ToUtf8;
+    std::vector<uint32_t> utf8ToUtf16;
+    transcodeUtf8(text, length, &utf16, &utf16ToUtf8, &utf8ToUtf16);
+    size_t utf8ReplacementEnd = utf8Replacement;
+    nextUtf8CodePoint(text, &utf8ReplacementEnd, length);
+
+    MinikinPaint paint;
+    paint.size = 10;
+    paint.scaleX = 1;
+    const FontStyle style;
+
+    LineBreaker expected;
+    expected.setLocale(icu::Locale::getUS(), nullptr);
+    expected.resize(utf16.size());
+    std::copy(utf16.begin(), utf16.end(), expected.buffer());
+    expected.setText();
+    expected.setLineWidths(35, 1, 45);
+    expected.addStyleRun(&paint, collection, style, 0, utf8ToUtf16[utf8Split], false);
+    expected.addStyleRun(&paint, collection, style, utf8ToUtf16[utf8Split], utf16.size(),
+            false);
+    expected.addReplacement(utf8ToUtf16[utf8Replacement], utf8ToUtf16[utf8ReplacementEnd], 5);
+    const size_t breakCount = expected.computeBreaks();
+
+    LineBreaker breaker;
+    breaker.setLocale(icu::Locale::getUS(), nullptr);
+    breaker.setTextUtf8(text, length);
+    breaker.setLineWidths(35, 1, 45);
+    breaker.addStyleRunUtf8(&paint, collection, style, 0, utf8Split, false);
+    breaker.addStyleRunUtf8(&paint, collection, style, utf8Split, length, false);
+    breaker.addReplacementUtf8(utf8Replacement, utf8ReplacementEnd, 5);
+    ASSERT_EQ(breakCount, breaker.computeBreaks());
+
+    for (size_t i = 0; i < breakCount; i++) {
+        EXPECT_EQ(static_cast<int>(utf16ToUtf8[expected.getBreaks()[i]]),
+                breaker.getBreaksUtf8()[i]);
+        EXPECT_EQ(expected.getWidths()[i], breaker.getWidths()[i]);
+        EXPECT_EQ(expected.getFlags()[i], breaker.getFlags()[i]);
+    }
+
+    std::vector<float> expectedWidths(length);
+    utf16ToUtf8Advances(utf16ToUtf8, expected.charWidths(), 0, utf16.size(),
+            expectedWidths.data(), 0, length);
+    std::vector<float> widths(length);
+    breaker.getCharWidthsUtf8(widths.data());
+    for (size_t i = 0; i < length; i++) {
+        EXPECT_EQ(expectedWidths[i], widths[i]);
+    }
+}
+
+TEST_F(LineBreakerTest, utf8MatchesUtf16) {
+    MinikinAutoUnref<FontCollection> collection(getFontCollection(kTestFontDir, kItemizeFontXml));
+
+    // "ab " U+3042 U+242EE " c de " U+3042 U+3044, split before U+242EE, which takes four bytes
+    // and a surrogate pair, and with U+3042 replaced.
+    const char kText[] = "\x61\x62\x20\xE3\x81\x82\xF0\xA4\x8B\xAE\x20\x63\x20\x64\x65\x20"
+            "\xE3\x81\x82\xE3\x81\x84";
+    expectUtf8BreaksMatchUtf16(collection.get(), kText, 6, 3);
+    expectUtf8BreaksMatchUtf16(collection.get(), kText, 16, 6);
+
+    // A lone continuation byte, a truncated sequence and an encoded surrogate decode to U+FFFD,
+    // as they do when converted to UTF-16.
+    const char kMalformed[] = "\x61\x80\x62\x20\xE3\x81\x20\xED\xA0\x80\x20\x63\x64\x20\x65";
+    expectUtf8BreaksMatchUtf16(collection.get(), kMalformed, 4, 7);
+}
+
+}  // namespace
+}  // namespace android
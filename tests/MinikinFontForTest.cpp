@@ -39,8 +39,8 @@ MinikinFontForTest::~MinikinFontForTest() {
 
 float MinikinFontForTest::GetHorizontalAdvance(uint32_t /* glyph_id */,
         const android::MinikinPaint& /* paint */) const {
-    LOG_ALWAYS_FATAL("MinikinFontForTest::GetHorizontalAdvance is not yet implemented");
-    return 0.0f;
+    // A fixed advance is enough for tests that compare layouts with each other.
+    return 10.0f;
 }
 
 void MinikinFontForTest::GetBounds(android::MinikinRect* /* bounds */, uint32_t /* glyph_id */,
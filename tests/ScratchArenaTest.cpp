@@ -0,0 +1,78 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <string.h>
+#include <vector>
+
+#include "ScratchArena.h"
+
+namespace android {
+
+TEST(ScratchArenaTest, alignmentTest) {
+    ScratchArena arena;
+    arena.allocate(1, 1);
+    void* p = arena.allocate(8, 8);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(p) % 8);
+    arena.allocate(3, 1);
+    int* ints = arena.allocateArray<int>(4);
+    EXPECT_EQ(0u, reinterpret_cast<uintptr_t>(ints) % alignof(int));
+}
+
+TEST(ScratchArenaTest, largeAllocationTest) {
+    ScratchArena arena;
+    // Allocations that do not fit the current block must not overwrite earlier ones.
+    std::vector<uint8_t*> blocks;
+    for (size_t i = 0; i < 16; i++) {
+        uint8_t* p = arena.allocateArray<uint8_t>(3000);
+        memset(p, i, 3000);
+        blocks.push_back(p);
+    }
+    for (size_t i = 0; i < blocks.size(); i++) {
+        for (size_t j = 0; j < 3000; j++) {
+            ASSERT_EQ(i, blocks[i][j]);
+        }
+    }
+}
+
+TEST(ScratchArenaTest, reuseAfterResetTest) {
+    ScratchArena arena;
+    for (size_t i = 0; i < 8; i++) {
+        arena.allocateArray<uint8_t>(3000);
+    }
+    arena.reset();
+    // After a reset, the same amount of work fits into a single block.
+    uint8_t* first = arena.allocateArray<uint8_t>(3000);
+    uint8_t* last = first;
+    for (size_t i = 1; i < 8; i++) {
+        last = arena.allocateArray<uint8_t>(3000);
+    }
+    EXPECT_EQ(first + 7 * 3000, last);
+}
+
+TEST(ScratchArenaTest, allocatorTest) {
+    ScratchArena arena;
+    std::vector<int, ScratchAllocator<int>> v((ScratchAllocator<int>(&arena)));
+    for (int i = 0; i < 1000; i++) {
+        v.push_back(i);
+    }
+    for (int i = 0; i < 1000; i++) {
+        EXPECT_EQ(i, v[i]);
+    }
+}
+
+}  // namespace android
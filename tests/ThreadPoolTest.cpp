@@ -0,0 +1,55 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <vector>
+
+#include "ThreadPool.h"
+
+namespace android {
+
+TEST(ThreadPoolTest, parallelForVisitsEveryIndexOnce) {
+    ThreadPool pool(4);
+    const size_t kCount = 1000;
+    std::vector<std::atomic<int>> visits(kCount);
+    for (size_t i = 0; i < kCount; i++) {
+        visits[i].store(0);
+    }
+    pool.parallelFor(kCount, [&visits](size_t i) { visits[i]++; });
+    for (size_t i = 0; i < kCount; i++) {
+        EXPECT_EQ(1, visits[i].load()) << "index " << i;
+    }
+}
+
+TEST(ThreadPoolTest, nestedParallelForRunsSerially) {
+    ThreadPool pool(2);
+    std::atomic<size_t> total(0);
+    pool.parallelFor(8, [&pool, &total](size_t) {
+        pool.parallelFor(8, [&total](size_t) { total++; });
+    });
+    EXPECT_EQ(64u, total.load());
+}
+
+TEST(ThreadPoolTest, noWorkers) {
+    ThreadPool pool(0);
+    size_t total = 0;
+    pool.parallelFor(10, [&total](size_t i) { total += i; });
+    EXPECT_EQ(45u, total);
+}
+
+}  // namespace android
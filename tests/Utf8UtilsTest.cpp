@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2017 The Android Open Source Project
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <gtest/gtest.h>
+
+#include "Utf8Utils.h"
+
+namespace android {
+
+TEST(Utf8UtilsTest, nextUtf8CodePointTest) {
+    // U+0041, U+00E9, U+3042, U+1F600
+    const uint8_t text[] = { 0x41, 0xC3, 0xA9, 0xE3, 0x81, 0x82, 0xF0, 0x9F, 0x98, 0x80 };
+    size_t offset = 0;
+    EXPECT_EQ(0x41u, nextUtf8CodePoint(text, &offset, sizeof(text)));
+    EXPECT_EQ(1u, offset);
+    EXPECT_EQ(0xE9u, nextUtf8CodePoint(text, &offset, sizeof(text)));
+    EXPECT_EQ(3u, offset);
+    EXPECT_EQ(0x3042u, nextUtf8CodePoint(text, &offset, sizeof(text)));
+    EXPECT_EQ(6u, offset);
+    EXPECT_EQ(0x1F600u, nextUtf8CodePoint(text, &offset, sizeof(text)));
+    EXPECT_EQ(10u, offset);
+}
+
+TEST(Utf8UtilsTest, malformedInputTest) {
+    // A lone continuation byte and a truncated sequence.
+    const uint8_t text[] = { 0x80, 0x41, 0xE3, 0x81 };
+    size_t offset = 0;
+    EXPECT_EQ(0xFFFDu, nextUtf8CodePoint(text, &offset, sizeof(text)));
+    EXPECT_EQ(1u, offset);
+    EXPECT_EQ(0x41u, nextUtf8CodePoint(text, &offset, sizeof(text)));
+    EXPECT_EQ(0xFFFDu, nextUtf8CodePoint(text, &offset, sizeof(text)));
+    EXPECT_EQ(sizeof(text), offset);
+}
+
+TEST(Utf8UtilsTest, transcodeTest) {
+    // U+0041, U+00E9, U+1F600
+    const uint8_t text[] = { 0x41, 0xC3, 0xA9, 0xF0, 0x9F, 0x98, 0x80 };
+    Utf8Transcoder transcoder;
+    transcoder.transcode(text, sizeof(text));
+
+    ASSERT_EQ(4u, transcoder.utf16.size());
+    EXPECT_EQ(0x0041, transcoder.utf16[0]);
+    EXPECT_EQ(0x00E9, transcoder.utf16[1]);
+    EXPECT_EQ(0xD83D, transcoder.utf16[2]);
+    EXPECT_EQ(0xDE00, transcoder.utf16[3]);
+
+    const uint32_t expectedUtf16ToUtf8[] = { 0, 1, 3, 3, 7 };
+    ASSERT_EQ(5u, transcoder.utf16ToUtf8.size());
+    for (size_t i = 0; i < 5; i++) {
+        EXPECT_EQ(expectedUtf16ToUtf8[i], transcoder.utf16ToUtf8[i]);
+    }
+    const uint32_t expectedUtf8ToUtf16[] = { 0, 1, 1, 2, 2, 2, 2, 4 };
+    ASSERT_EQ(8u, transcoder.utf8ToUtf16.size());
+    for (size_t i = 0; i < 8; i++) {
+        EXPECT_EQ(expectedUtf8ToUtf16[i], transcoder.utf8ToUtf16[i]);
+    }
+
+    const float utf16Advances[] = { 1.0f, 2.0f, 3.0f, 0.0f };
+    float utf8Advances[7];
+    transcoder.toUtf8Advances(utf16Advances, 0, 4, utf8Advances, 0, 7);
+    const float expectedAdvances[] = { 1.0f, 2.0f, 0.0f, 3.0f, 0.0f, 0.0f, 0.0f };
+    for (size_t i = 0; i < 7; i++) {
+        EXPECT_EQ(expectedAdvances[i], utf8Advances[i]);
+    }
+}
+
+}  // namespace android